@@ -8,12 +8,20 @@ namespace Secretest
 {
     ClientWindow::ClientWindow(uvec2 size, Address address) :
         Window("Secretest", uvec2(), size),
-        Client(address)
+        Client(address),
+        _messages(WindowTransform{ vec2(32), vec2(512, 1), TransformMode::Absolute, vec<2, TransformMode>(TransformMode::Absolute, TransformMode::Relative) }, *this)
     {
         SetMinSize(512);
 
         _connectingStatusWindow = std::make_unique<ConnectingStatusWindow>();
 
+        // The text views the receive buffer, it has to be copied to cross over to the UI thread.
+        Handlers_.On<ChatMessage>([this](const ChatMessage& message)
+        {
+            if(_inbox.Push(std::string(message.Text)))
+                Tasks.Emplace(&ClientWindow::FlushMessages, this);
+        });
+
         ConnectAsync(3, std::chrono::duration<float>(1.f));
     }
 
@@ -22,15 +30,36 @@ namespace Secretest
 
     }
 
-    void ClientWindow::PushMessage(std::string_view str)
+    void ClientWindow::OnScroll(int32_t delta)
+    {
+        _messages.Scroll(-delta * 3);
+    }
+
+    void ClientWindow::FlushMessages()
     {
-        _messages.emplace_back(str, WindowTransform{ vec2(_messagePosition), vec2(512, 32), TransformMode::Absolute, TransformMode::Absolute }, *this);
-        _messagePosition.y += 32;
+        _inbox.Take(_pendingMessages);
+
+        const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + FrameBudget;
+
+        size_t flushed = 0;
+        while(flushed < _pendingMessages.size() && std::chrono::steady_clock::now() < deadline)
+        {
+            const size_t count = std::min(FlushChunkSize, _pendingMessages.size() - flushed);
+            _messages.Push(std::span(_pendingMessages).subspan(flushed, count));
+            flushed += count;
+        }
+
+        _pendingMessages.erase(_pendingMessages.begin(), _pendingMessages.begin() + flushed);
+        _messages.RepaintAll();
+
+        if(!_pendingMessages.empty() && _inbox.Reschedule())
+            Tasks.Emplace(&ClientWindow::FlushMessages, this);
     }
 
     void ClientWindow::UpdateStatusWindow(std::string_view string) const
     {
-        _connectingStatusWindow->SetStatusLabel(string);
+        if(_connectingStatusWindow)
+            _connectingStatusWindow->SetStatusLabel(string);
     }
 
     void ClientWindow::CloseStatusWindow()
@@ -38,10 +67,12 @@ namespace Secretest
         _connectingStatusWindow = nullptr;
     }
 
-    void ClientWindow::OnMessage(std::span<const char> message)
+    void ClientWindow::Reconnect()
     {
-        Client::OnMessage(message);
-        Tasks.Emplace(&ClientWindow::PushMessage, this, std::string(message.begin(), message.end()));
+        _connectingStatusWindow = std::make_unique<ConnectingStatusWindow>();
+
+        // Session state survives, so the server only replays what we missed.
+        ConnectAsync(3, std::chrono::duration<float>(1.f));
     }
 
     void ClientWindow::OnConnectAttempt(uint8_t attempt)
@@ -62,6 +93,12 @@ namespace Secretest
         Tasks.Emplace(&ClientWindow::CloseStatusWindow, this);
     }
 
+    void ClientWindow::OnDisconnect()
+    {
+        Client::OnDisconnect();
+        Tasks.Emplace(&ClientWindow::Reconnect, this);
+    }
+
     ConnectingStatusWindow::ConnectingStatusWindow() :
         Window("Connecting to Server", uvec2(), uvec2(256), WindowType::Popup),
         _statusLabel("Connecting to server.", WindowTransform(vec2(), vec2(1.f)), *this)
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <Secretest/Windowing/Window.h>
+#include <Secretest/Windowing/MessageList.h>
 #include <Secretest/Networking/Socket.h>
 
 namespace Secretest
@@ -27,18 +28,26 @@ namespace Secretest
 
     protected:
         void OnCommand() override;
+        void OnScroll(int32_t delta) override;
         void OnConnect() override;
-        void OnMessage(std::span<const char> message) override;
+        void OnDisconnect() override;
         void OnConnectAttempt(uint8_t attempt) override;
         void OnConnectFailure() override;
 
-        void PushMessage(std::string_view str);
+        void FlushMessages();
         void UpdateStatusWindow(std::string_view string) const;
         void CloseStatusWindow();
+        void Reconnect();
 
     private:
-        std::list<Label> _messages;
-        uvec2 _messagePosition{ 32, 32 };
+        MessageList _messages;
+
+        // Messages from the network thread, applied to the list at most once per frame.
+        Inbox<std::string> _inbox;
+        std::vector<std::string> _pendingMessages;
+        // Whatever doesn't fit is left for the next frame so input and painting keep up during floods.
+        static constexpr std::chrono::milliseconds FrameBudget{ 8 };
+        static constexpr size_t FlushChunkSize = 256;
 
         std::unique_ptr<ConnectingStatusWindow> _connectingStatusWindow;
     };
@@ -0,0 +1,274 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+// End to end latency over loopback: Client::Send, the server's receive loop and SendToClientsExcept,
+// and every other client's handler. One client sends open loop at a fixed rate; every frame carries the
+// time it was meant to go out and the time it did. Latency counted from the intended time includes any
+// stall of the sender or the path behind it (coordinated omission), the raw number only what one frame saw.
+// Everything runs once per socket profile.
+
+#include <Secretest/Networking/Socket.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <print>
+#include <thread>
+#include <vector>
+
+using namespace Secretest;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr uint16_t Port = 3284;
+
+    // Log-linear, 2^(PrecisionBits - 1) buckets per power of two, so anything it reports is within 1.6%.
+    class LatencyHistogram
+    {
+    public:
+        void Record(Clock::duration value)
+        {
+            const uint64_t nanoseconds = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(value).count());
+            _buckets[GetIndex(nanoseconds)]++;
+            _count++;
+            _max = std::max(_max, nanoseconds);
+        }
+
+        void Merge(const LatencyHistogram& b)
+        {
+            for(size_t i = 0; i < _buckets.size(); i++)
+                _buckets[i] += b._buckets[i];
+            _count += b._count;
+            _max = std::max(_max, b._max);
+        }
+
+        // Upper edge of the bucket the percentile falls into.
+        [[nodiscard]] std::chrono::duration<double, std::micro> GetPercentile(double percentile) const
+        {
+            const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(percentile / 100 * _count + 0.5));
+
+            uint64_t seen = 0;
+            for(size_t i = 0; i < _buckets.size(); i++)
+                if((seen += _buckets[i]) >= rank)
+                    return std::chrono::nanoseconds(std::min(GetUpperBound(i), _max));
+
+            return std::chrono::nanoseconds(_max);
+        }
+
+        [[nodiscard]] uint64_t GetCount() const { return _count; }
+        [[nodiscard]] std::chrono::duration<double, std::micro> GetMax() const { return std::chrono::nanoseconds(_max); }
+
+    private:
+        static constexpr size_t PrecisionBits = 7;
+        static constexpr uint64_t Exact = 1 << PrecisionBits;
+        static constexpr uint64_t Half = Exact / 2;
+
+        static size_t GetIndex(uint64_t value)
+        {
+            if(value < Exact)
+                return value;
+
+            const size_t shift = std::bit_width(value) - PrecisionBits;
+            return Exact + (shift - 1) * Half + ((value >> shift) - Half);
+        }
+
+        static uint64_t GetUpperBound(size_t index)
+        {
+            if(index < Exact)
+                return index;
+
+            const size_t shift = (index - Exact) / Half + 1;
+            const uint64_t top = (index - Exact) % Half + Half;
+            return ((top + 1) << shift) - 1;
+        }
+
+        std::array<uint64_t, Exact + (64 - PrecisionBits) * Half> _buckets{};
+        uint64_t _count = 0;
+        uint64_t _max = 0;
+    };
+
+    struct LatencyStamp
+    {
+        Clock::rep Intended;
+        Clock::rep Sent;
+    };
+
+    class RelayServer final : public Server
+    {
+    public:
+        RelayServer(uint16_t port, const SocketOptions& socket) :
+            Server(port, ServerOptions{ .RateLimit = RateLimitOptions{ .FramesPerSecond = 0, .BytesPerSecond = 0 }, .Socket = socket })
+        {
+            Handlers_.On<ChatMessage>([this](ClientConnection& sender, const ChatMessage& message)
+            {
+                ClientConnection* except[] = { &sender };
+                SendToClientsExcept(std::span<const char>(message.Text), except);
+            });
+        }
+    };
+
+    class LatencyClient final : public Client
+    {
+    public:
+        LatencyClient(Address address, const SocketOptions& socket) : Client(address, ConnectOptions{ .Socket = socket })
+        {
+            Handlers_.On<ChatMessage>([this](const ChatMessage& message)
+            {
+                const Clock::time_point now = Clock::now();
+
+                LatencyStamp stamp;
+                std::memcpy(&stamp, message.Text.data(), sizeof(stamp));
+
+                Corrected.Record(now - Clock::time_point(Clock::duration(stamp.Intended)));
+                Raw.Record(now - Clock::time_point(Clock::duration(stamp.Sent)));
+                Received.fetch_add(1, std::memory_order_release);
+            });
+        }
+
+        // Written by the listening thread, read once Received says everything is in.
+        LatencyHistogram Corrected;
+        LatencyHistogram Raw;
+        std::atomic<uint64_t> Received = 0;
+
+    protected:
+        void OnConnect() override {}
+        void OnDisconnect() override {}
+    };
+
+    struct LatencyRun
+    {
+        size_t MessageSize;
+        // Offered load, messages per second from the sender.
+        uint32_t Rate;
+        std::chrono::milliseconds Duration;
+    };
+
+    void Run(std::vector<std::unique_ptr<LatencyClient>>& clients, const LatencyRun& run)
+    {
+        for(const auto& client : clients)
+        {
+            client->Corrected = {};
+            client->Raw = {};
+            client->Received = 0;
+        }
+
+        const uint64_t messageCount = std::max<uint64_t>(1, run.Rate * run.Duration.count() / 1000);
+        const Clock::duration interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / run.Rate));
+
+        LatencyClient& sender = *clients.front();
+        std::vector<char> payload(std::max(run.MessageSize, sizeof(LatencyStamp)));
+
+        // Open loop: the schedule never waits for the system, a late frame counts from when it was due.
+        const Clock::time_point start = Clock::now();
+        for(uint64_t i = 0; i < messageCount; i++)
+        {
+            const Clock::time_point intended = start + interval * i;
+            std::this_thread::sleep_until(intended);
+
+            const LatencyStamp stamp{ intended.time_since_epoch().count(), Clock::now().time_since_epoch().count() };
+            std::memcpy(payload.data(), &stamp, sizeof(stamp));
+            std::ignore = sender.Send(payload);
+        }
+
+        // Whatever hasn't arrived a second after the last send is counted as lost.
+        const Clock::time_point deadline = Clock::now() + std::chrono::seconds(1);
+        const auto isDone = [&]
+        {
+            return std::ranges::all_of(clients.begin() + 1, clients.end(), [&](const auto& client) { return client->Received.load(std::memory_order_acquire) >= messageCount; });
+        };
+        while(!isDone() && Clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        LatencyHistogram corrected, raw;
+        uint64_t received = 0;
+        for(auto client = clients.begin() + 1; client != clients.end(); ++client)
+        {
+            received += (*client)->Received.load(std::memory_order_acquire);
+            corrected.Merge((*client)->Corrected);
+            raw.Merge((*client)->Raw);
+        }
+
+        const uint64_t expected = messageCount * (clients.size() - 1);
+        std::println("{:>5} {:>7} {:>7} | {:>9.1f} {:>9.1f} {:>9.1f} {:>9.1f} {:>9.1f} | {:>9.1f} {:>9.1f} | {:>6}",
+            clients.size(), run.MessageSize, run.Rate,
+            corrected.GetPercentile(50).count(), corrected.GetPercentile(90).count(), corrected.GetPercentile(99).count(),
+            corrected.GetPercentile(99.9).count(), corrected.GetMax().count(),
+            raw.GetPercentile(50).count(), raw.GetPercentile(99).count(),
+            expected - std::min(expected, received));
+    }
+}
+
+int main()
+{
+    SocketContext context{};
+
+    struct Profile
+    {
+        std::string_view Name;
+        SocketOptions Socket;
+    };
+
+    const std::array profiles
+    {
+        Profile{ "system", SocketOptions::System() },
+        Profile{ "interactive", SocketOptions::Interactive() },
+        Profile{ "bulk", SocketOptions::Bulk() }
+    };
+
+    constexpr std::array roomSizes{ 2, 8, 32 };
+    constexpr std::array messageSizes{ 64, 1024, 16384 };
+    constexpr std::array rates{ 1000, 10000 };
+
+    std::println("Latency in us, corrected for coordinated omission unless marked raw.");
+
+    for(size_t profile = 0; profile < profiles.size(); profile++)
+    {
+        // A port per profile, the last server's connections may still be closing.
+        const uint16_t port = Port + profile;
+
+        RelayServer server(port, profiles[profile].Socket);
+        server.Listen();
+
+        std::println("\nSocket profile: {}", profiles[profile].Name);
+        std::println("{:>5} {:>7} {:>7} | {:>9} {:>9} {:>9} {:>9} {:>9} | {:>9} {:>9} | {:>6}",
+            "room", "bytes", "msg/s", "p50", "p90", "p99", "p99.9", "max", "raw p50", "raw p99", "lost");
+
+        // Rooms only grow, clients that are already in stay connected and keep receiving.
+        std::vector<std::unique_ptr<LatencyClient>> clients;
+        for(const size_t roomSize : roomSizes)
+        {
+            while(clients.size() < roomSize)
+            {
+                clients.push_back(std::make_unique<LatencyClient>(Address(LOCALHOST, port), profiles[profile].Socket));
+                if(!clients.back()->Connect())
+                {
+                    std::println("Failed to connect client {}.", clients.size());
+                    return 1;
+                }
+            }
+
+            // Let the server finish the handshakes before the clock starts.
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+            for(const size_t messageSize : messageSizes)
+                for(const uint32_t rate : rates)
+                    Run(clients, LatencyRun{ messageSize, rate, std::chrono::seconds(1) });
+        }
+
+        for(const auto& client : clients)
+            client->Close();
+        server.Close();
+
+        // The listening threads are detached, give them a moment to notice before everything goes away.
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    return 0;
+}
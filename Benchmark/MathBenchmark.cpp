@@ -0,0 +1,193 @@
+//
+// Created by scion on 1/25/2026.
+//
+
+// Generic templates against the float specializations in vec4.h/mat4.h. The specializations are checked against the
+// generic templates before anything is measured, and the constant-evaluated paths are checked at compile time.
+
+#include <Secretest/Utility/vec3.h>
+#include <Secretest/Utility/mat3.h>
+#include <Secretest/Utility/mat4.h>
+
+#include <chrono>
+#include <cmath>
+#include <print>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Small integers and powers of two, so every result below is exact and can be compared with ==.
+    constexpr mat4 Affine()
+    {
+        mat4 m;
+        m[0] = vec4(0, 2, 0, 0);
+        m[1] = vec4(4, 0, 0, 0);
+        m[2] = vec4(0, 0, 0.5f, 0);
+        m[3] = vec4(1, 2, 3, 1);
+        return m;
+    }
+
+    constexpr mat4 Projective()
+    {
+        mat4 m = Affine();
+        m[0][3] = 1;
+        m[3][3] = 0;
+        return m;
+    }
+
+    constexpr vec4 Point() { return vec4(1, -2, 3, 1); }
+
+    static_assert(mat_multiply(mat_invert(Affine()), Affine()) == mat_identity<4, float>);
+    static_assert(mat_multiply(Affine(), mat_invert(Affine())) == mat_identity<4, float>);
+    static_assert(mat_multiply(mat_invert(Projective()), Projective()) == mat_identity<4, float>);
+    static_assert(mat_invert_affine(Affine()) == mat_invert(Affine()));
+    static_assert(mat_transpose(mat_transpose(Projective())) == Projective());
+    // Column major, the right hand side is applied first.
+    static_assert(mat_multiply(mat_multiply(Affine(), Projective()), Point()) == mat_multiply(Affine(), mat_multiply(Projective(), Point())));
+    static_assert(mat_multiply(Affine(), Point()) == vec4(-7, 4, 4.5f, 1));
+    static_assert(vec_dot(Point(), vec4(2, 1, 1, 1)) == 4);
+    static_assert(Point() * 2.f - vec4(1) == vec4(1, -5, 5, 1));
+
+    // det = 2, the inverse is exact in halves.
+    constexpr mat3 Basis()
+    {
+        mat3 m;
+        m[0] = vec3(2, 1, 0);
+        m[1] = vec3(1, 1, 1);
+        m[2] = vec3(0, 0, 2);
+        return m;
+    }
+
+    constexpr mat3 Shear()
+    {
+        mat3 m = mat_identity<3, float>;
+        m[1][0] = 3;
+        return m;
+    }
+
+    static_assert(Basis().determinant() == 2);
+    static_assert((Basis() * Shear()).determinant() == Basis().determinant() * Shear().determinant());
+    static_assert(Basis() * Basis().inverse() == mat_identity<3, float>);
+    static_assert([]
+    {
+        mat3 a = Basis() * Shear();
+        mat3 b = Shear();
+        vec3 point(1, 2, 3);
+        const vec3 applied = b * point;
+        return a * point == Basis() * applied;
+    }());
+
+    // Relative to the size of the value, generic and specialized paths only differ in rounding.
+    bool IsClose(float a, float b)
+    {
+        return std::abs(a - b) <= 1e-5f * std::max(1.f, std::abs(b));
+    }
+
+    bool IsClose(const vec4& a, const vec4& b)
+    {
+        for(size_t i = 0; i < 4; i++)
+            if(!IsClose(a[i], b[i]))
+                return false;
+        return true;
+    }
+
+    bool IsClose(const mat4& a, const mat4& b)
+    {
+        for(size_t i = 0; i < 4; i++)
+            if(!IsClose(a[i], b[i]))
+                return false;
+        return true;
+    }
+
+    template<typename FUNC_T>
+    bool Verify(std::string_view name, const std::vector<mat4>& matrices, FUNC_T&& func)
+    {
+        for(size_t i = 0; i < matrices.size(); i++)
+        {
+            if(func(i))
+                continue;
+
+            std::println("{} differs from the generic template for matrix {}", name, i);
+            return false;
+        }
+        return true;
+    }
+
+    template<typename FUNC_T>
+    void Measure(std::string_view name, size_t iterations, FUNC_T&& func)
+    {
+        const Clock::time_point start = Clock::now();
+        func();
+        const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+        std::println("{:<32} {:>10.3f} ns/op", name, elapsed.count() / iterations);
+    }
+}
+
+int main()
+{
+    constexpr size_t count = 1 << 16;
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+
+    std::vector<mat4> matrices(count);
+    std::vector<vec4> vectors(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        for(size_t x = 0; x < 4; x++)
+        {
+            vectors[i][x] = distribution(random);
+            for(size_t y = 0; y < 4; y++)
+                matrices[i][x][y] = distribution(random) + (x == y ? 4 : 0);
+        }
+        matrices[i][0][3] = matrices[i][1][3] = matrices[i][2][3] = 0;
+        matrices[i][3][3] = 1;
+    }
+
+    // Neighbours, so every product is of two different matrices.
+    const auto other = [&](size_t i) -> const mat4& { return matrices[i ^ 1]; };
+
+    const bool isCorrect =
+        Verify("mat4 multiply", matrices, [&](size_t i) { return IsClose(mat_multiply(matrices[i], other(i)), mat_multiply<4, float>(matrices[i], other(i))); }) &&
+        Verify("mat4 * vec4", matrices, [&](size_t i) { return IsClose(mat_multiply(matrices[i], vectors[i]), mat_multiply<4, float>(matrices[i], vectors[i])); }) &&
+        Verify("mat4 transpose", matrices, [&](size_t i) { return mat_transpose(matrices[i]) == mat_transpose<4, float>(matrices[i]); }) &&
+        Verify("mat4 inverse", matrices, [&](size_t i) { return IsClose(mat_invert(matrices[i]), mat_invert<4, float>(matrices[i])); }) &&
+        Verify("mat4 affine inverse", matrices, [&](size_t i) { return IsClose(mat_invert_affine(matrices[i]), mat_invert<4, float>(matrices[i])); }) &&
+        Verify("vec4 operators", matrices, [&](size_t i)
+        {
+            const vec4& a = vectors[i];
+            const vec4& b = matrices[i][0];
+            return a + b == operator+<4, float>(a, b) && a - b == operator-<4, float>(a, b) &&
+                a * b == operator*<4, float>(a, b) && a / b == operator/<4, float>(a, b) &&
+                a * 3.f == operator*<4, float>(a, 3.f) && IsClose(vec_dot(a, b), vec_dot<4, float>(a, b));
+        });
+    if(!isCorrect)
+        return 1;
+
+    // Every product is stored, so none of them can be cut down to what the checksum reads.
+    std::vector<mat4> results(count);
+    vec4 sum = vec4(0);
+
+    Measure("mat4 multiply (generic)", count, [&] { for(size_t i = 0; i < count; i++) results[i] = mat_multiply<4, float>(matrices[i], other(i)); });
+    Measure("mat4 multiply", count, [&] { for(size_t i = 0; i < count; i++) results[i] = mat_multiply(matrices[i], other(i)); });
+
+    Measure("mat4 * vec4 (generic)", count, [&] { for(size_t i = 0; i < count; i++) sum += mat_multiply<4, float>(matrices[i], vectors[i]); });
+    Measure("mat4 * vec4", count, [&] { for(size_t i = 0; i < count; i++) sum += mat_multiply(matrices[i], vectors[i]); });
+
+    Measure("mat4 inverse (generic)", count, [&] { for(size_t i = 0; i < count; i++) results[i] = mat_invert<4, float>(matrices[i]); });
+    Measure("mat4 inverse", count, [&] { for(size_t i = 0; i < count; i++) results[i] = mat_invert(matrices[i]); });
+
+    Measure("mat4 affine inverse (generic)", count, [&] { for(size_t i = 0; i < count; i++) results[i] = mat_invert_affine<float>(matrices[i]); });
+    Measure("mat4 affine inverse", count, [&] { for(size_t i = 0; i < count; i++) results[i] = mat_invert_affine(matrices[i]); });
+
+    // Keeps the loops from being optimized out.
+    for(const mat4& result : results)
+        sum += result[0] + result[3];
+    std::println("checksum {}", vec_dot(sum, vec4(1)));
+
+    return 0;
+}
@@ -0,0 +1,499 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+// Runs a relaying server against in-process peers on a SimulatedNetwork. The server is polled
+// from this thread and the network only moves when it is advanced, so every run is the same.
+// Latencies are virtual time on the simulated network, throughput is wall time spent in the server.
+// Windows only for now: no socket is opened, but Server itself is built on Winsock and the Win32 file API.
+
+#include <Secretest/Networking/SimulatedNetwork.h>
+#include <Secretest/Networking/Socket.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <print>
+#include <vector>
+
+using namespace Secretest;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr SimulatedNetwork::Duration Step{ 100 };
+
+    // Sends every chat frame on to everyone but its sender.
+    class RelayServer final : public Server
+    {
+    public:
+        // Every simulated peer comes from the same address. Links to other nodes are dialed through dialPeer.
+        explicit RelayServer(std::function<std::unique_ptr<ITransport>(const Address&)> dialPeer = nullptr) :
+            Server(ServerOptions{ .RateLimit = RateLimitOptions{ .FramesPerSecond = 0, .BytesPerSecond = 0 }, .MaxConnectionsPerAddress = 0, .DialPeer = std::move(dialPeer) })
+        {
+            Handlers_.On<ChatMessage>([this](ClientConnection& sender, const ChatMessage& message)
+            {
+                ClientConnection* except[] = { &sender };
+                SendToClientsExcept(std::span<const char>(message.Text), except);
+            });
+        }
+
+        void Broadcast(std::span<const char> message) { SendToClients(message); }
+    };
+
+    struct Peer
+    {
+        IOConnection Connection;
+        uint64_t Epoch = 0;
+        uint64_t Sequence = 0;
+        std::vector<SimulatedNetwork::Duration> Latencies;
+        // Kept for following a redirect.
+        LinkOptions Upstream;
+        LinkOptions Downstream;
+        size_t Redirects = 0;
+    };
+
+    struct Scenario
+    {
+        std::string_view Name;
+        size_t PeerCount = 64;
+        size_t MessageCount = 1000;
+        size_t MessageSize = 256;
+        // One message from the first peer every interval.
+        SimulatedNetwork::Duration Interval{ 1000 };
+        LinkOptions Link;
+        // The last peer gets this downstream instead, to see what one slow consumer does.
+        std::optional<LinkOptions> SlowLink;
+    };
+
+    void Connect(SimulatedNetwork& network, Peer& peer, const Address& address, const LinkOptions& upstream, const LinkOptions& downstream)
+    {
+        peer.Connection = IOConnection(network.Connect(address, upstream, downstream));
+        peer.Upstream = upstream;
+        peer.Downstream = downstream;
+        std::ignore = peer.Connection.Send(ResumeMessage{ peer.Epoch, DefaultRoom, peer.Sequence });
+    }
+
+    void Drain(SimulatedNetwork& network, Peer& peer)
+    {
+        MessageHeader header;
+        std::vector<char> buffer;
+
+        // Frames arrive whole, a readable peer never blocks halfway through one.
+        while(peer.Connection.IsReadable() && peer.Connection.Receive(header, buffer))
+        {
+            if(header.Type == MessageType::Session)
+                peer.Epoch = MessageSerializer<SessionMessage>::Deserialize(buffer).value_or(SessionMessage{}).Epoch;
+            else if(header.Type == MessageType::Ping)
+                std::ignore = peer.Connection.Send(PongMessage{ MessageSerializer<PingMessage>::Deserialize(buffer).value_or(PingMessage{}).Timestamp });
+            else if(header.Type == MessageType::Data && header.Sequence > peer.Sequence)
+            {
+                peer.Sequence = header.Sequence;
+
+                SimulatedNetwork::Duration::rep sentAt;
+                std::memcpy(&sentAt, buffer.data(), sizeof(sentAt));
+                peer.Latencies.push_back(network.GetTime() - SimulatedNetwork::Duration(sentAt));
+            }
+            else if(header.Type == MessageType::Redirect)
+            {
+                // The room's history moved along, it resumes there with what it has.
+                const RedirectMessage redirect = MessageSerializer<RedirectMessage>::Deserialize(buffer).value_or(RedirectMessage{});
+                peer.Redirects++;
+                return Connect(network, peer, Address(redirect.IP[0], redirect.IP[1], redirect.IP[2], redirect.IP[3], redirect.Port), peer.Upstream, peer.Downstream);
+            }
+        }
+    }
+
+    // Moves time in steps, letting the server and every peer catch up after each one.
+    void Run(SimulatedNetwork& network, RelayServer& server, std::vector<Peer>& peers, SimulatedNetwork::Duration time)
+    {
+        for(SimulatedNetwork::Duration elapsed{ 0 }; elapsed < time; elapsed += Step)
+        {
+            network.Advance(Step);
+            server.Poll();
+            for(Peer& peer : peers)
+                Drain(network, peer);
+        }
+    }
+
+    void RunUntilIdle(SimulatedNetwork& network, RelayServer& server, std::vector<Peer>& peers)
+    {
+        // Twice in a row, a frame the server relays only goes in flight after the Poll.
+        for(size_t idle = 0; idle < 2; idle = network.GetBytesInFlight() ? 0 : idle + 1)
+            Run(network, server, peers, Step);
+    }
+
+    // The server only takes so many connections per Poll.
+    void RunUntilConnected(SimulatedNetwork& network, RelayServer& server, std::vector<Peer>& peers)
+    {
+        while(server.GetClients().size() < peers.size())
+            Run(network, server, peers, Step);
+        RunUntilIdle(network, server, peers);
+    }
+
+    void PrintLatencies(std::string_view name, std::vector<SimulatedNetwork::Duration> latencies)
+    {
+        if(latencies.empty())
+            return std::println("{:<32} nothing delivered", name);
+
+        std::ranges::sort(latencies);
+        const auto percentile = [&](double p) { return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))].count(); };
+
+        std::println("{:<32} {:>8} frames p50 {:>8} us p99 {:>8} us max {:>8} us", name, latencies.size(), percentile(0.5), percentile(0.99), latencies.back().count());
+    }
+
+    void PrintStatistics(const SimulatedNetwork& network)
+    {
+        const NetworkStatistics statistics = network.GetStatistics();
+        std::println("{:<32} sent {} delivered {} lost {} retransmitted {} reordered {} bytes {}", "",
+            statistics.Sent, statistics.Delivered, statistics.Lost, statistics.Retransmitted, statistics.Reordered, statistics.BytesDelivered);
+    }
+
+    void RunFanOut(const Scenario& scenario)
+    {
+        const Address address(LOCALHOST, 3283);
+
+        SimulatedNetwork network;
+        RelayServer server;
+        network.Listen(address, [&](std::unique_ptr<ITransport> transport, Address peer) { server.Adopt(std::move(transport), peer); });
+
+        std::vector<Peer> peers(scenario.PeerCount);
+        for(size_t i = 0; i < peers.size(); i++)
+            Connect(network, peers[i], address, scenario.Link, scenario.SlowLink && i + 1 == peers.size() ? *scenario.SlowLink : scenario.Link);
+        RunUntilConnected(network, server, peers);
+
+        std::vector<char> payload(std::max(scenario.MessageSize, sizeof(SimulatedNetwork::Duration::rep)));
+
+        Clock::duration serverTime{};
+        for(size_t i = 0; i < scenario.MessageCount; i++)
+        {
+            const SimulatedNetwork::Duration::rep now = network.GetTime().count();
+            std::memcpy(payload.data(), &now, sizeof(now));
+            std::ignore = peers.front().Connection.Send(payload);
+
+            for(SimulatedNetwork::Duration elapsed{ 0 }; elapsed < scenario.Interval; elapsed += Step)
+            {
+                network.Advance(Step);
+
+                const Clock::time_point start = Clock::now();
+                server.Poll();
+                serverTime += Clock::now() - start;
+
+                for(Peer& peer : peers)
+                    Drain(network, peer);
+            }
+        }
+        RunUntilIdle(network, server, peers);
+
+        const std::chrono::duration<double, std::micro> perMessage = serverTime / scenario.MessageCount;
+        std::println("{} ({} peers, {} B, one per {} us)", scenario.Name, scenario.PeerCount, scenario.MessageSize, scenario.Interval.count());
+        std::println("{:<32} {:>10.3f} us/message {:>10.3f} us/delivery", "Server", perMessage.count(), perMessage.count() / (scenario.PeerCount - 1));
+
+        std::vector<SimulatedNetwork::Duration> latencies;
+        for(size_t i = 1; i + (scenario.SlowLink ? 1 : 0) < peers.size(); i++)
+            latencies.insert(latencies.end(), peers[i].Latencies.begin(), peers[i].Latencies.end());
+        PrintLatencies("Latency", latencies);
+        if(scenario.SlowLink)
+            PrintLatencies("Latency, slow peer", peers.back().Latencies);
+        PrintStatistics(network);
+    }
+
+    void RunReconnect(size_t peerCount, size_t messageCount)
+    {
+        const Address address(LOCALHOST, 3283);
+        const LinkOptions link{ .Latency = std::chrono::milliseconds(5) };
+
+        SimulatedNetwork network;
+        RelayServer server;
+        network.Listen(address, [&](std::unique_ptr<ITransport> transport, Address peer) { server.Adopt(std::move(transport), peer); });
+
+        std::vector<Peer> peers(peerCount);
+        for(Peer& peer : peers)
+            Connect(network, peer, address, link, link);
+        RunUntilConnected(network, server, peers);
+
+        // Half the history goes out while everyone is connected, the other half while they are all gone.
+        std::vector<char> payload(64);
+        for(size_t i = 0; i < messageCount; i++)
+        {
+            if(i == messageCount / 2)
+            {
+                network.DisconnectAll();
+                RunUntilIdle(network, server, peers);
+            }
+
+            const SimulatedNetwork::Duration::rep now = network.GetTime().count();
+            std::memcpy(payload.data(), &now, sizeof(now));
+            server.Broadcast(payload);
+            Run(network, server, peers, Step);
+        }
+
+        for(Peer& peer : peers)
+            peer.Latencies.clear();
+
+        const SimulatedNetwork::Duration reconnectedAt = network.GetTime();
+        const Clock::time_point start = Clock::now();
+
+        for(Peer& peer : peers)
+            Connect(network, peer, address, link, link);
+        RunUntilConnected(network, server, peers);
+
+        const std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+        const SimulatedNetwork::Duration caughtUp = network.GetTime() - reconnectedAt;
+
+        size_t replayed = 0;
+        for(const Peer& peer : peers)
+            replayed += peer.Latencies.size();
+
+        std::println("Reconnect ({} peers, {} frames missed each)", peerCount, messageCount - messageCount / 2);
+        std::println("{:<32} {:>10.1f} us total, {} frames replayed, caught up after {} us virtual", "Resume", elapsed.count(), replayed, caughtUp.count());
+        PrintStatistics(network);
+    }
+
+    // A persistent server goes down after messageCount messages and a new one restores the room from disk. Restore time
+    // should only depend on the backlog and the log since the last snapshot, not on how long the first one ran.
+    void RunRestart(size_t messageCount)
+    {
+        const Address address(LOCALHOST, 3283);
+        const std::filesystem::path directory = std::filesystem::temp_directory_path() / "SecretestBenchmark";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        const std::string path = (directory / "room").string();
+
+        uint64_t epoch;
+        std::chrono::duration<double, std::micro> logged;
+        {
+            RelayServer server;
+            server.EnablePersistence(path);
+
+            std::vector<char> payload(256);
+            const Clock::time_point start = Clock::now();
+            for(size_t i = 0; i < messageCount; i++)
+            {
+                server.Broadcast(payload);
+                server.Poll();
+            }
+            logged = Clock::now() - start;
+
+            epoch = server.GetNodeID();
+            server.Close();
+        }
+
+        SimulatedNetwork network;
+        RelayServer server;
+
+        const Clock::time_point start = Clock::now();
+        server.EnablePersistence(path);
+        const std::chrono::duration<double, std::micro> restored = Clock::now() - start;
+
+        // Resuming with the old token has to pick up right where it left off.
+        network.Listen(address, [&](std::unique_ptr<ITransport> transport, Address peer) { server.Adopt(std::move(transport), peer); });
+        std::vector<Peer> peers(1);
+        peers[0].Epoch = epoch;
+        peers[0].Sequence = messageCount - 10;
+        Connect(network, peers[0], address, {}, {});
+        RunUntilConnected(network, server, peers);
+        RunUntilIdle(network, server, peers);
+
+        std::println("Restart ({} messages before)", messageCount);
+        std::println("{:<32} {:>10.1f} us per message", "Logged", logged.count() / messageCount);
+        std::println("{:<32} {:>10.1f} us, {} frames replayed on resume, at sequence {}", "Restored", restored.count(), peers[0].Latencies.size(), peers[0].Sequence);
+
+        server.Close();
+        std::filesystem::remove_all(directory);
+    }
+
+    // Nodes in a full mesh, the peers spread over them round robin. The first peer sends, everyone else should
+    // get every message exactly once, whichever node they are on.
+    void RunFederation(size_t nodeCount, size_t peerCount, size_t messageCount, const LinkOptions& link)
+    {
+        SimulatedNetwork network;
+
+        std::vector<std::unique_ptr<RelayServer>> nodes;
+        std::vector<Address> addresses;
+        for(size_t i = 0; i < nodeCount; i++)
+        {
+            addresses.emplace_back(LOCALHOST, 3283 + i);
+            RelayServer& node = *nodes.emplace_back(std::make_unique<RelayServer>(network.GetDialer(link, link)));
+            network.Listen(addresses.back(), [&node](std::unique_ptr<ITransport> transport, Address peer) { node.Adopt(std::move(transport), peer); });
+
+            // One link per pair, dialed by the later node.
+            for(size_t j = 0; j < i; j++)
+                node.AddPeer(addresses[j]);
+        }
+
+        const auto step = [&](std::vector<Peer>& peers)
+        {
+            network.Advance(Step);
+            for(const auto& node : nodes)
+                node->Poll();
+            for(Peer& peer : peers)
+                Drain(network, peer);
+        };
+
+        std::vector<Peer> peers(peerCount);
+        for(size_t i = 0; i < peers.size(); i++)
+            Connect(network, peers[i], addresses[i % nodeCount], link, link);
+
+        // Every peer, and both ends of every link.
+        const size_t connectionCount = peerCount + nodeCount * (nodeCount - 1);
+        const auto countConnections = [&]
+        {
+            size_t count = 0;
+            for(const auto& node : nodes)
+                count += node->GetClients().size();
+            return count;
+        };
+        while(countConnections() < connectionCount)
+            step(peers);
+        for(size_t idle = 0; idle < 2; idle = network.GetBytesInFlight() ? 0 : idle + 1)
+            step(peers);
+
+        std::vector<char> payload(sizeof(SimulatedNetwork::Duration::rep));
+        for(size_t i = 0; i < messageCount; i++)
+        {
+            const SimulatedNetwork::Duration::rep now = network.GetTime().count();
+            std::memcpy(payload.data(), &now, sizeof(now));
+            std::ignore = peers.front().Connection.Send(payload);
+
+            step(peers);
+        }
+        for(size_t idle = 0; idle < 2; idle = network.GetBytesInFlight() ? 0 : idle + 1)
+            step(peers);
+
+        std::vector<SimulatedNetwork::Duration> local, remote;
+        for(size_t i = 1; i < peers.size(); i++)
+        {
+            std::vector<SimulatedNetwork::Duration>& latencies = i % nodeCount ? remote : local;
+            latencies.insert(latencies.end(), peers[i].Latencies.begin(), peers[i].Latencies.end());
+        }
+
+        std::println("Federation ({} nodes, {} peers, {} messages)", nodeCount, peerCount, messageCount);
+        std::println("{:<32} {} of {} delivered", "", local.size() + remote.size(), messageCount * (peerCount - 1));
+        PrintLatencies("Latency, same node", local);
+        PrintLatencies("Latency, other nodes", remote);
+        PrintStatistics(network);
+    }
+
+    // Every peer starts on one node, which sends half the messages. Then a second node joins the ring and takes
+    // the room over; the peers are redirected while the new owner sends the other half. Everyone should end up
+    // on the new owner with every message exactly once.
+    void RunMigration(size_t peerCount, size_t messageCount, const LinkOptions& link)
+    {
+        SimulatedNetwork network;
+
+        const Address addresses[] = { Address(LOCALHOST, 3283), Address(LOCALHOST, 3284) };
+        HashRing<Address> ring;
+        for(const Address& address : addresses)
+            ring.Add(static_cast<std::string>(address), address);
+
+        // Whichever node the ring gives the room to joins, the other one starts out with it.
+        const size_t owner = *ring.GetOwner(DefaultRoom) == addresses[1];
+        const size_t origin = 1 - owner;
+
+        std::vector<std::unique_ptr<RelayServer>> nodes;
+        for(const Address& address : addresses)
+        {
+            RelayServer& node = *nodes.emplace_back(std::make_unique<RelayServer>(network.GetDialer(link, link)));
+            network.Listen(address, [&node](std::unique_ptr<ITransport> transport, Address peer) { node.Adopt(std::move(transport), peer); });
+        }
+        nodes[1]->AddPeer(addresses[0]);
+
+        // Until it joins, the new node is in nobody's ring, its own included.
+        HashRing<Address> before;
+        before.Add(static_cast<std::string>(addresses[origin]), addresses[origin]);
+        for(size_t i = 0; i < nodes.size(); i++)
+            nodes[i]->SetRing(before, addresses[i]);
+
+        const auto step = [&](std::vector<Peer>& peers)
+        {
+            network.Advance(Step);
+            for(const auto& node : nodes)
+                node->Poll();
+            for(Peer& peer : peers)
+                Drain(network, peer);
+        };
+        const auto countPeers = [&](const RelayServer& node)
+        {
+            return std::ranges::count_if(node.GetClients(), [](const ClientConnection& client) { return !client.IsPeer(); });
+        };
+
+        std::vector<Peer> peers(peerCount);
+        for(Peer& peer : peers)
+            Connect(network, peer, addresses[origin], link, link);
+        while(static_cast<size_t>(countPeers(*nodes[origin])) < peerCount)
+            step(peers);
+        for(size_t idle = 0; idle < 2; idle = network.GetBytesInFlight() ? 0 : idle + 1)
+            step(peers);
+
+        std::vector<char> payload(sizeof(SimulatedNetwork::Duration::rep));
+        const auto send = [&](RelayServer& node)
+        {
+            const SimulatedNetwork::Duration::rep now = network.GetTime().count();
+            std::memcpy(payload.data(), &now, sizeof(now));
+            node.Broadcast(payload);
+            step(peers);
+        };
+
+        for(size_t i = 0; i < messageCount / 2; i++)
+            send(*nodes[origin]);
+
+        const SimulatedNetwork::Duration joinedAt = network.GetTime();
+        const Clock::time_point start = Clock::now();
+        for(size_t i = 0; i < nodes.size(); i++)
+            nodes[i]->SetRing(ring, addresses[i]);
+
+        std::optional<SimulatedNetwork::Duration> movedAfter;
+        for(size_t i = messageCount / 2; i < messageCount; i++)
+        {
+            send(*nodes[owner]);
+            if(!movedAfter && static_cast<size_t>(countPeers(*nodes[owner])) == peerCount)
+                movedAfter = network.GetTime() - joinedAt;
+        }
+        for(size_t idle = 0; idle < 2; idle = network.GetBytesInFlight() ? 0 : idle + 1)
+            step(peers);
+
+        const std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+
+        size_t delivered = 0, redirected = 0, complete = 0;
+        for(const Peer& peer : peers)
+        {
+            delivered += peer.Latencies.size();
+            redirected += peer.Redirects;
+            complete += peer.Sequence == messageCount;
+        }
+
+        std::println("Migration ({} peers, {} messages, half after the room moves)", peerCount, messageCount);
+        std::println("{:<32} {} of {} delivered, {} redirected, {} peers complete", "", delivered, messageCount * peerCount, redirected, complete);
+        if(movedAfter)
+            std::println("{:<32} {:>10.1f} us total, every peer moved after {} us virtual", "Rebalance", elapsed.count(), movedAfter->count());
+        else
+            std::println("{:<32} {} of {} peers moved", "Rebalance", countPeers(*nodes[owner]), peerCount);
+        PrintStatistics(network);
+    }
+}
+
+int main()
+{
+    RunFanOut(Scenario{ .Name = "Fan-out, perfect network" });
+    RunFanOut(Scenario{ .Name = "Fan-out, 20 ms", .Link = LinkOptions{ .Latency = std::chrono::milliseconds(20), .Jitter = std::chrono::milliseconds(5) } });
+    RunFanOut(Scenario{ .Name = "Fan-out, 20 ms, 1% loss", .Link = LinkOptions{ .Latency = std::chrono::milliseconds(20), .LossRate = 0.01, .ReorderRate = 0.01 } });
+    RunFanOut(Scenario{ .Name = "Fan-out, large room", .PeerCount = 1024, .MessageCount = 200 });
+    RunFanOut(Scenario{ .Name = "Backpressure, one slow peer", .MessageSize = 1024, .Link = LinkOptions{ .Latency = std::chrono::milliseconds(5) },
+                        .SlowLink = LinkOptions{ .Latency = std::chrono::milliseconds(5), .BytesPerSecond = 512 * 1024 } });
+
+    RunReconnect(64, 1000);
+
+    RunFederation(3, 96, 1000, LinkOptions{ .Latency = std::chrono::milliseconds(1) });
+    RunMigration(64, 1000, LinkOptions{ .Latency = std::chrono::milliseconds(1) });
+
+    RunRestart(10000);
+    RunRestart(200000);
+
+    return 0;
+}
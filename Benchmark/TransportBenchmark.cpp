@@ -0,0 +1,139 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+// Frames through IOConnection over each transport that stays on this machine: one thread streams to another,
+// then the two play ping-pong. Both ends live in this process, which runs the same code as two would.
+
+#include <Secretest/Networking/SharedMemory.h>
+#include <Secretest/Networking/Socket.h>
+#include <Secretest/Networking/UnixSocket.h>
+
+#include <algorithm>
+#include <chrono>
+#include <print>
+#include <thread>
+#include <vector>
+
+using namespace Secretest;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using TransportPair = std::pair<std::unique_ptr<ITransport>, std::unique_ptr<ITransport>>;
+
+    void RunStream(std::string_view name, TransportPair transports, size_t messageCount, size_t messageSize)
+    {
+        IOConnection sender(std::move(transports.first));
+        IOConnection receiver(std::move(transports.second));
+
+        const Clock::time_point start = Clock::now();
+
+        std::thread thread([&]
+        {
+            const std::vector<char> payload(messageSize);
+            for(size_t i = 0; i < messageCount; i++)
+                std::ignore = sender.Send(payload);
+        });
+
+        MessageHeader header;
+        std::vector<char> buffer;
+        size_t received = 0;
+        while(received < messageCount && receiver.Receive(header, buffer))
+            received++;
+
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+        thread.join();
+
+        std::println("{:<16} stream {:>6} B {:>10.2f} M msg/s {:>10.1f} MB/s", name, messageSize,
+            received / elapsed.count() / 1e6, received * (messageSize + sizeof(MessageHeader)) / elapsed.count() / 1e6);
+    }
+
+    void RunPingPong(std::string_view name, TransportPair transports, size_t roundTrips)
+    {
+        IOConnection client(std::move(transports.first));
+        IOConnection server(std::move(transports.second));
+
+        std::thread echo([&]
+        {
+            MessageHeader header;
+            std::vector<char> buffer;
+            while(server.Receive(header, buffer))
+                std::ignore = server.Send(buffer);
+        });
+
+        const std::vector<char> payload(64);
+        MessageHeader header;
+        std::vector<char> buffer;
+
+        std::vector<Clock::duration> latencies;
+        latencies.reserve(roundTrips);
+        for(size_t i = 0; i < roundTrips; i++)
+        {
+            const Clock::time_point start = Clock::now();
+            if(!client.Send(payload) || !client.Receive(header, buffer))
+                break;
+            latencies.push_back(Clock::now() - start);
+        }
+
+        client.Close();
+        echo.join();
+
+        if(latencies.empty())
+            return std::println("{:<16} ping-pong failed", name);
+
+        std::ranges::sort(latencies);
+        const auto percentile = [&](double p)
+        {
+            return std::chrono::duration<double, std::micro>(latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))]).count();
+        };
+
+        std::println("{:<16} round trip p50 {:>8.2f} us p99 {:>8.2f} us p99.9 {:>8.2f} us", name, percentile(0.5), percentile(0.99), percentile(0.999));
+    }
+
+    TransportPair ConnectSharedMemory(SharedMemoryListener& listener, std::string_view name)
+    {
+        std::unique_ptr<ITransport> client = SharedMemoryTransport::Connect(name);
+
+        Address address;
+        std::unique_ptr<ITransport> server = listener.Accept(address);
+
+        return { std::move(client), std::move(server) };
+    }
+
+    TransportPair ConnectUnixSocket(UnixSocketListener& listener, std::string_view path)
+    {
+        std::unique_ptr<ITransport> client = Secretest::ConnectUnixSocket(path);
+
+        Address address;
+        std::unique_ptr<ITransport> server = listener.Accept(address);
+
+        return { std::move(client), std::move(server) };
+    }
+}
+
+int main()
+{
+    SocketContext context{};
+
+    constexpr std::string_view listenerName = "TransportBenchmark";
+    SharedMemoryListener listener(listenerName);
+
+    constexpr std::string_view socketPath = "TransportBenchmark.sock";
+    UnixSocketListener socketListener{ std::string(socketPath) };
+
+    for(const size_t messageSize : { 64, 1024, 16384 })
+    {
+        const size_t messageCount = 64 * 1024 * 1024 / (messageSize + sizeof(MessageHeader));
+
+        RunStream("memory", MemoryTransport::CreatePair(), messageCount, messageSize);
+        RunStream("shared memory", ConnectSharedMemory(listener, listenerName), messageCount, messageSize);
+        RunStream("unix socket", ConnectUnixSocket(socketListener, socketPath), messageCount, messageSize);
+    }
+
+    RunPingPong("memory", MemoryTransport::CreatePair(), 100000);
+    RunPingPong("shared memory", ConnectSharedMemory(listener, listenerName), 100000);
+    RunPingPong("unix socket", ConnectUnixSocket(socketListener, socketPath), 100000);
+
+    return 0;
+}
@@ -0,0 +1,205 @@
+//
+// Created by scion on 1/23/2026.
+//
+
+// Runs the widget layer against the headless backend, so it builds and runs anywhere.
+
+#include <Secretest/Windowing/HeadlessBackend.h>
+#include <Secretest/Windowing/MessageList.h>
+
+#include <chrono>
+#include <list>
+#include <print>
+#include <thread>
+#include <vector>
+
+using namespace Secretest;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    template<typename FUNC_T>
+    void Measure(std::string_view name, size_t iterations, FUNC_T&& func)
+    {
+        const Clock::time_point start = Clock::now();
+        func();
+        const std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+
+        std::println("{:<32} {:>10.1f} us total {:>10.3f} us/op", name, elapsed.count(), elapsed.count() / iterations);
+    }
+
+    void PrintStatistics(const HeadlessBackend& backend)
+    {
+        const HeadlessStatistics& statistics = backend.GetStatistics();
+        std::println("{:<32} created {} destroyed {} rects {} texts {} invalidations {} paints {}", "",
+            statistics.Created, statistics.Destroyed, statistics.RectUpdates, statistics.TextUpdates, statistics.Invalidations, statistics.Paints);
+    }
+
+    // The old shape of the client's chat history: one label per message, stacked downwards.
+    class MessageWindow final : public Window
+    {
+    public:
+        MessageWindow() : Window("Benchmark", uvec2(), uvec2(980, 720)) {}
+
+        void PushMessage(std::string_view str)
+        {
+            _messages.emplace_back(str, WindowTransform{ vec2(_messagePosition), vec2(512, 32), TransformMode::Absolute, TransformMode::Absolute }, *this);
+            _messagePosition.y += 32;
+        }
+
+        void PushMessageTask(std::string str) { Tasks.Emplace(&MessageWindow::PushMessage, this, std::move(str)); }
+
+    private:
+        std::list<Label> _messages;
+        uvec2 _messagePosition{ 32, 32 };
+    };
+}
+
+int main()
+{
+    HeadlessBackend backend;
+    IWindow::SetBackend(backend);
+
+    constexpr size_t widgetCount = 10000;
+    constexpr size_t resizeCount = 100;
+    constexpr size_t messageCount = 5000;
+
+    {
+        Window window("Benchmark", uvec2(), uvec2(980, 720));
+        std::list<Label> labels;
+
+        backend.ResetStatistics();
+        Measure("Create labels", widgetCount, [&]
+        {
+            for(size_t i = 0; i < widgetCount; i++)
+                labels.emplace_back("Label", WindowTransform{ vec2(0, i / float(widgetCount)), vec2(1, 1 / float(widgetCount)) }, window);
+        });
+        PrintStatistics(backend);
+
+        backend.ResetStatistics();
+        Measure("Resize and paint", resizeCount, [&]
+        {
+            for(size_t i = 0; i < resizeCount; i++)
+            {
+                backend.SimulateResize(window, uvec2(640 + i, 480 + i));
+                backend.PumpOnce();
+            }
+        });
+        PrintStatistics(backend);
+
+        backend.ResetStatistics();
+        Measure("Destroy labels", widgetCount, [&] { labels.clear(); });
+        PrintStatistics(backend);
+    }
+
+    {
+        MessageWindow window;
+
+        backend.ResetStatistics();
+        Measure("Queue messages", messageCount, [&]
+        {
+            for(size_t i = 0; i < messageCount; i++)
+                window.PushMessageTask(std::format("Message {}", i));
+        });
+
+        Measure("Drain message tasks", messageCount, [&] { backend.PumpOnce(); });
+        PrintStatistics(backend);
+
+        backend.ResetStatistics();
+        Measure("Paint full history", 1, [&]
+        {
+            window.RepaintAll();
+            backend.PumpOnce();
+        });
+        PrintStatistics(backend);
+    }
+
+    {
+        Window window("Benchmark", uvec2(), uvec2(980, 720));
+        MessageList list(WindowTransform{ vec2(32), vec2(512, 1), TransformMode::Absolute, vec<2, TransformMode>(TransformMode::Absolute, TransformMode::Relative) }, window);
+
+        backend.ResetStatistics();
+        Measure("Push to message list", messageCount, [&]
+        {
+            for(size_t i = 0; i < messageCount; i++)
+                list.Push(std::format("Message {}", i));
+        });
+        PrintStatistics(backend);
+
+        // What the client does with a burst from the network: one task and one bind for all of it.
+        Inbox<std::string> inbox;
+        std::vector<std::string> pending;
+        size_t flushes = 0;
+
+        backend.ResetStatistics();
+        Measure("Burst through inbox", messageCount, [&]
+        {
+            for(size_t i = 0; i < messageCount; i++)
+            {
+                if(!inbox.Push(std::format("Burst {}", i)))
+                    continue;
+
+                backend.GetTasks().Emplace([&]
+                {
+                    inbox.Take(pending);
+                    list.Push(pending);
+                    pending.clear();
+                    list.RepaintAll();
+                    flushes++;
+                });
+            }
+
+            backend.PumpOnce();
+        });
+        PrintStatistics(backend);
+        std::println("{:<32} flushes {}", "", flushes);
+
+        backend.ResetStatistics();
+        Measure("Scroll message list", messageCount, [&]
+        {
+            for(size_t i = 0; i < messageCount; i++)
+                list.Scroll(i % 2 ? 5 : -5);
+        });
+        PrintStatistics(backend);
+
+        backend.ResetStatistics();
+        Measure("Paint message list", 1, [&]
+        {
+            window.RepaintAll();
+            backend.PumpOnce();
+        });
+        PrintStatistics(backend);
+    }
+
+    {
+        // Time from a task being queued on another thread to it running on an idle UI loop.
+        constexpr size_t wakeCount = 200;
+        std::chrono::duration<double, std::micro> total{};
+        std::chrono::duration<double, std::micro> worst{};
+
+        std::thread producer([&]
+        {
+            for(size_t i = 0; i < wakeCount; i++)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+                backend.GetTasks().Emplace([&, queued = Clock::now()]
+                {
+                    const std::chrono::duration<double, std::micro> latency = Clock::now() - queued;
+                    total += latency;
+                    worst = std::max(worst, latency);
+                });
+            }
+
+            backend.GetTasks().Emplace([&] { backend.Quit(); });
+        });
+
+        backend.Run();
+        producer.join();
+
+        std::println("{:<32} {:>10.3f} us mean {:>10.3f} us worst", "Idle wake latency", total.count() / wakeCount, worst.count());
+    }
+
+    return 0;
+}
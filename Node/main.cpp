@@ -0,0 +1,200 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+// Headless chat node: relays chat between its clients and federates with the nodes on the other ports.
+// SecretestNode <port> [peer port...]. Every node can be given the same list, only the higher port of a pair dials.
+// Rooms are spread over the nodes by a hash ring of the same ports. "add <port>" and "remove <port>" on stdin change
+// the ring and rebalance; every node has to be told the same. Runs until stdin closes or reads "quit".
+// Starting a node on a port that already runs one takes its clients over without dropping them; the old one exits.
+// Rooms are kept in SecretestNode.<port>.* and survive the node going down.
+
+#include <Secretest/Networking/Socket.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Secretest;
+
+namespace
+{
+    class NodeServer final : public Server
+    {
+    public:
+        explicit NodeServer(uint16_t port) : Server(port) { AddHandlers(); }
+        // Without a socket, for taking over a running node.
+        NodeServer() : Server(ServerOptions{}) { AddHandlers(); }
+
+    private:
+        void AddHandlers()
+        {
+            Handlers_.On<ChatMessage>([this](ClientConnection& sender, const ChatMessage& message)
+            {
+                ClientConnection* except[] = { &sender };
+                SendToClientsExcept(std::span<const char>(message.Text), except);
+            });
+        }
+    };
+
+    // Read on its own thread, the node has to notice being replaced while nobody types.
+    class LineReader
+    {
+    public:
+        LineReader()
+        {
+            std::thread([this]()
+            {
+                std::string line;
+                while(std::getline(std::cin, line))
+                {
+                    std::scoped_lock lock{ _state };
+                    _lines.push_back(std::move(line));
+                }
+
+                std::scoped_lock lock{ _state };
+                _isClosed = true;
+            }).detach();
+        }
+
+        // False once stdin is closed and drained.
+        bool Next(std::optional<std::string>& line)
+        {
+            std::scoped_lock lock{ _state };
+
+            line = std::nullopt;
+            if(!_lines.empty())
+            {
+                line = std::move(_lines.front());
+                _lines.pop_front();
+                return true;
+            }
+            return !_isClosed;
+        }
+
+    private:
+        std::mutex _state;
+        std::deque<std::string> _lines;
+        bool _isClosed = false;
+    };
+
+    std::optional<uint16_t> ParsePort(const char* text)
+    {
+        uint16_t port;
+        const char* end = text + std::strlen(text);
+        if(const auto [last, error] = std::from_chars(text, end, port); error != std::errc() || last != end || !port)
+            return std::nullopt;
+        return port;
+    }
+
+    // Linked once, even if it leaves the ring and comes back.
+    void AddNode(NodeServer& node, HashRing<Address>& ring, std::vector<uint16_t>& linked, uint16_t self, uint16_t port)
+    {
+        ring.Add(std::to_string(port), Address(LOCALHOST, port));
+
+        if(port == self || std::ranges::contains(linked, port))
+            return;
+        linked.push_back(port);
+
+        if(port < self)
+            node.AddPeer(Address(LOCALHOST, port));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::optional<uint16_t> port = argc > 1 ? ParsePort(argv[1]) : std::nullopt;
+    if(!port)
+    {
+        std::println("Usage: SecretestNode <port> [peer port...]");
+        return 1;
+    }
+
+    SocketContext context{};
+
+    try
+    {
+        const std::string restartPath = std::format("SecretestNode.{}.sock", *port);
+
+        // The node already on the port hands everything over, or there is none and we start fresh.
+        std::unique_ptr<NodeServer> node = std::make_unique<NodeServer>();
+        const bool isTakeOver = node->TakeOver(restartPath);
+        if(!isTakeOver)
+            node = std::make_unique<NodeServer>(*port);
+
+        HashRing<Address> ring;
+        std::vector<uint16_t> linked;
+        AddNode(*node, ring, linked, *port, *port);
+
+        for(int i = 2; i < argc; i++)
+        {
+            const std::optional<uint16_t> peer = ParsePort(argv[i]);
+            if(!peer)
+            {
+                std::println("Not a port: {}", argv[i]);
+                return 1;
+            }
+
+            AddNode(*node, ring, linked, *port, *peer);
+        }
+
+        node->SetRing(ring, Address(LOCALHOST, *port));
+        node->EnablePersistence(std::format("SecretestNode.{}", *port));
+        node->EnableHotRestart(restartPath);
+        node->Listen();
+        std::println("Node {:016x} {} {}, {} nodes in the ring.", node->GetNodeID(), isTakeOver ? "took over" : "listening on", *port, ring.GetNodeCount());
+
+        LineReader input;
+        std::optional<std::string> line;
+        while(input.Next(line) && line != "quit" && !node->IsHandedOff())
+        {
+            if(!line)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+
+            const bool isAdd = line->starts_with("add ");
+            if(!isAdd && !line->starts_with("remove "))
+                continue;
+
+            const std::optional<uint16_t> changed = ParsePort(line->c_str() + line->find(' ') + 1);
+            if(!changed || *changed == *port)
+            {
+                std::println("Not a port of another node: {}", *line);
+                continue;
+            }
+
+            // A removed node keeps its link, it just owns nothing anymore.
+            if(isAdd)
+                AddNode(*node, ring, linked, *port, *changed);
+            else
+                ring.Remove(std::to_string(*changed));
+
+            node->SetRing(ring, Address(LOCALHOST, *port));
+            std::println("{} nodes in the ring.", ring.GetNodeCount());
+        }
+
+        if(node->IsHandedOff())
+            std::println("Handed over to the new node.");
+        node->Close();
+    }
+    catch(const ServerCreationException& e)
+    {
+        std::println("{}", e.What);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+//
+// Created by scion on 1/18/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace Secretest
+{
+    struct BacklogEntry
+    {
+        uint64_t Sequence;
+        // Never changed once pushed, so a snapshot can share it with the live backlog.
+        std::shared_ptr<const char[]> Bytes;
+        size_t Size;
+
+        [[nodiscard]] std::span<const char> GetData() const { return { Bytes.get(), Size }; }
+    };
+
+    // Bounded history of a room. Sequences are contiguous, so finding where a client left off is O(1).
+    class MessageBacklog
+    {
+    public:
+        explicit MessageBacklog(size_t capacity = 1024) : _capacity(capacity) {}
+
+        uint64_t Push(std::span<const char> message)
+        {
+            if(_entries.size() >= _capacity)
+                _entries.pop_front();
+
+            std::shared_ptr<char[]> bytes = std::make_shared_for_overwrite<char[]>(message.size());
+            std::memcpy(bytes.get(), message.data(), message.size());
+
+            _entries.push_back(BacklogEntry{ ++_sequence, std::move(bytes), message.size() });
+            return _sequence;
+        }
+
+        // Empties the backlog and numbers on from sequence, for history handed over from another node.
+        void Rebase(uint64_t sequence)
+        {
+            _entries.clear();
+            _sequence = sequence;
+        }
+
+        [[nodiscard]] uint64_t GetSequence() const { return _sequence; }
+        [[nodiscard]] size_t GetCapacity() const { return _capacity; }
+
+        // Copies the handles only, the messages themselves are shared.
+        [[nodiscard]] std::vector<BacklogEntry> GetEntries() const { return { _entries.begin(), _entries.end() }; }
+
+        // Anything older than the backlog is lost; the client gets what is left.
+        template<typename FUNC_T>
+        void ForEachAfter(uint64_t sequence, FUNC_T&& func) const
+        {
+            if(_entries.empty() || sequence >= _sequence)
+                return;
+
+            const uint64_t first = _entries.front().Sequence;
+            const size_t start = sequence < first ? 0 : sequence - first + 1;
+
+            for(size_t i = start; i < _entries.size(); i++)
+                func(_entries[i]);
+        }
+
+    private:
+        std::deque<BacklogEntry> _entries;
+        size_t _capacity;
+        uint64_t _sequence = 0;
+    };
+}
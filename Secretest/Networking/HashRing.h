@@ -0,0 +1,91 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Secretest
+{
+    // Consistent hashing with virtual nodes. Every node gets a number of points on a 64-bit ring proportional to its
+    // weight, a key belongs to the first point at or after its hash. Adding or removing a node only moves the keys
+    // between its points and their predecessors. Placement depends on nothing but the names and weights, so rings
+    // built from the same nodes agree on every machine without talking to each other.
+    template<typename NODE_T>
+    class HashRing
+    {
+    public:
+        explicit HashRing(uint32_t pointsPerWeight = 128) : _pointsPerWeight(std::max(pointsPerWeight, 1u)) {}
+
+        // Replaces a node of the same name.
+        void Add(std::string_view name, NODE_T node, uint32_t weight = 1)
+        {
+            Remove(name);
+
+            const uint64_t nameHash = HashName(name);
+            for(uint64_t i = 0; i < static_cast<uint64_t>(weight) * _pointsPerWeight; i++)
+                _points.push_back(Point{ Mix(nameHash + i * 0x9E3779B97F4A7C15), nameHash });
+            std::ranges::sort(_points, {}, &Point::Hash);
+
+            _nodes.emplace_back(nameHash, std::move(node));
+        }
+
+        void Remove(std::string_view name)
+        {
+            const uint64_t nameHash = HashName(name);
+            std::erase_if(_points, [nameHash](const Point& point) { return point.Node == nameHash; });
+            std::erase_if(_nodes, [nameHash](const auto& node) { return node.first == nameHash; });
+        }
+
+        // Null while the ring is empty.
+        [[nodiscard]] const NODE_T* GetOwner(uint64_t key) const
+        {
+            if(_points.empty())
+                return nullptr;
+
+            const uint64_t hash = Mix(key);
+            auto point = std::ranges::lower_bound(_points, hash, {}, &Point::Hash);
+            if(point == _points.end())
+                point = _points.begin();
+
+            const auto node = std::ranges::find(_nodes, point->Node, &std::pair<uint64_t, NODE_T>::first);
+            return &node->second;
+        }
+
+        [[nodiscard]] size_t GetNodeCount() const { return _nodes.size(); }
+
+    private:
+        struct Point
+        {
+            uint64_t Hash;
+            uint64_t Node;
+        };
+
+        // FNV-1a, spelled out so every build hashes names the same.
+        static uint64_t HashName(std::string_view name)
+        {
+            uint64_t hash = 0xCBF29CE484222325;
+            for(const char c : name)
+                hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3;
+            return Mix(hash);
+        }
+
+        // SplitMix64's finalizer, so keys that are small consecutive integers still land all over the ring.
+        static uint64_t Mix(uint64_t x)
+        {
+            x = (x ^ x >> 30) * 0xBF58476D1CE4E5B9;
+            x = (x ^ x >> 27) * 0x94D049BB133111EB;
+            return x ^ x >> 31;
+        }
+
+        uint32_t _pointsPerWeight;
+        std::vector<Point> _points;
+        std::vector<std::pair<uint64_t, NODE_T>> _nodes;
+    };
+}
@@ -0,0 +1,414 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#include "Socket.h"
+#include "StateStore.h"
+#include "UnixSocket.h"
+
+#include <optional>
+#include <ranges>
+#include <winsock2.h>
+#include <windows.h>
+
+// The predecessor listens on the restart path. A successor connects and sends its process ID, the predecessor
+// duplicates every socket for that process and sends them with its state in one frame. The successor opens them,
+// acknowledges, and from then on owns them; the predecessor closes its own handles, which leaves the sockets alone,
+// and says so. Nothing is read from a handed socket in between, whatever arrives waits in the kernel for the successor.
+// Part of a frame already read comes along with the connection's state.
+
+namespace Secretest
+{
+    namespace
+    {
+        constexpr uint32_t RestartMagic = 0x54535253;
+        // How long a handoff waits on each answer from the successor. The server stands still meanwhile.
+        constexpr std::chrono::seconds HandOffTimeout{ 2 };
+
+        enum class HandedFlags : uint8_t
+        {
+            Handshaken = 1 << 0,
+            Peer = 1 << 1,
+            Dialed = 1 << 2,
+            PingPending = 1 << 3,
+            // Taken through a listener, its options follow.
+            Listened = 1 << 4
+        };
+
+        std::optional<WSAPROTOCOL_INFOA> Duplicate(SOCKET socket, DWORD processID)
+        {
+            WSAPROTOCOL_INFOA info;
+            if(WSADuplicateSocketA(socket, processID, &info) == SOCKET_ERROR)
+                return std::nullopt;
+            return info;
+        }
+
+        SOCKET Open(WSAPROTOCOL_INFOA info)
+        {
+            const SOCKET socket = WSASocketA(FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, &info, 0, 0);
+            if(socket == InvalidSocket)
+                return InvalidSocket;
+
+            // Neither the blocking mode nor inheritance comes along, both belong to the handle. Like any the server
+            // accepts, it doesn't block.
+            u_long mode = 1;
+            ioctlsocket(socket, FIONBIO, &mode);
+            SetHandleInformation(reinterpret_cast<HANDLE>(socket), HANDLE_FLAG_INHERIT, 0);
+            return socket;
+        }
+
+        struct HandedConnection
+        {
+            WSAPROTOCOL_INFOA Info;
+            Address Target;
+            uint8_t Flags;
+            std::shared_ptr<const ListenerOptions> Listener;
+            std::vector<RoomID> Rooms;
+            std::vector<IOConnection::QueuedFrame> Queued;
+            std::vector<char> Unsent;
+            std::vector<char> Inbound;
+            SOCKET Socket = InvalidSocket;
+        };
+    }
+
+    void Server::EnableHotRestart(std::string path)
+    {
+        std::unique_ptr<IListener> listener = std::make_unique<UnixSocketListener>(std::move(path));
+
+        std::scoped_lock lock{ _state };
+        _restartListener = std::move(listener);
+    }
+
+    bool Server::HandOff()
+    {
+        Address address;
+        std::unique_ptr<ITransport> transport = _restartListener->Accept(address);
+        if(!transport)
+            return false;
+
+        IOConnection successor(std::move(transport));
+
+        MessageHeader header;
+        std::vector<char> buffer;
+        if(!successor.Receive(header, buffer, HandOffTimeout))
+            return false;
+
+        StateReader request(buffer);
+        const uint32_t magic = request.Read<uint32_t>();
+        const DWORD processID = request.Read<uint32_t>();
+        if(!request.IsValid() || magic != RestartMagic)
+            return false;
+
+        Log<LogLevel::Info>("Handing off to process {}.", processID);
+
+        // Only sockets can be handed on, anything else reconnects to the successor. Duplicated before anything waits on
+        // the handoff, the client list only changes on this thread.
+        const std::optional<WSAPROTOCOL_INFOA> listening = IConnection::IsOpen() ? Duplicate(Socket_, processID) : std::nullopt;
+
+        std::vector<std::pair<ClientConnection*, WSAPROTOCOL_INFOA>> duplicated;
+        for(ClientConnection& client : _clients)
+        {
+            const SocketTransport* socket = dynamic_cast<const SocketTransport*>(client.Transport_.get());
+            if(!socket || !socket->IsOpen())
+                continue;
+
+            if(const std::optional<WSAPROTOCOL_INFOA> info = Duplicate(socket->GetSocket(), processID))
+                duplicated.emplace_back(&client, *info);
+        }
+
+        // Until the successor has everything, broadcasts from other threads wait rather than number a message or queue
+        // a frame that would miss the handoff.
+        std::unique_lock rooms{ _roomState };
+
+        StateWriter state;
+        state.Write(RestartMagic);
+        state.Write(_epoch);
+
+        state.Write<uint8_t>(listening.has_value());
+        if(listening)
+        {
+            state.Write(*listening);
+            state.Write(Address_);
+        }
+
+        WriteRooms(state, SnapshotRooms());
+
+        state.Write<uint64_t>(_rooms.size());
+        for(const auto& [room, entry] : _rooms)
+        {
+            state.Write(room);
+            state.Write(entry->RelaySequence);
+        }
+
+        state.Write<uint64_t>(_importedEpochs.size());
+        for(const auto& [room, epoch] : _importedEpochs)
+        {
+            state.Write(room);
+            state.Write(epoch);
+        }
+
+        uint64_t relayedCount = 0;
+        for(const auto& sequences : _relayed | std::views::values)
+            relayedCount += sequences.size();
+
+        state.Write(relayedCount);
+        for(const auto& [origin, sequences] : _relayed)
+        {
+            for(const auto& [room, sequence] : sequences)
+            {
+                state.Write(origin);
+                state.Write(room);
+                state.Write(sequence);
+            }
+        }
+
+        std::vector<std::pair<ClientConnection*, std::vector<IOConnection::QueuedFrame>>> handed;
+        StateWriter connections;
+        for(const auto& [client, info] : duplicated)
+        {
+            const uint8_t flags =
+                (client->_isHandshaken ? static_cast<uint8_t>(HandedFlags::Handshaken) : 0) |
+                (client->_isPeer ? static_cast<uint8_t>(HandedFlags::Peer) : 0) |
+                (client->_isDialed ? static_cast<uint8_t>(HandedFlags::Dialed) : 0) |
+                (client->_isPingPending ? static_cast<uint8_t>(HandedFlags::PingPending) : 0) |
+                (client->_listener ? static_cast<uint8_t>(HandedFlags::Listened) : 0);
+
+            connections.Write(info);
+            connections.Write(client->GetAddress());
+            connections.Write(flags);
+            if(client->_listener)
+                connections.Write(*client->_listener);
+
+            connections.Write<uint64_t>(client->_rooms.size());
+            for(const RoomID room : client->_rooms)
+                connections.Write(room);
+
+            // A frame part way written goes first, or the client would read the next one from the middle of it.
+            std::vector<IOConnection::QueuedFrame> queued = client->TakeQueued();
+            connections.WriteBytes(client->GetUnsent());
+            connections.Write<uint64_t>(queued.size());
+            for(const auto& [priority, frame] : queued)
+            {
+                connections.Write(priority);
+                connections.WriteBytes(*frame);
+            }
+
+            connections.WriteBytes(client->GetInbound());
+
+            handed.emplace_back(client, std::move(queued));
+        }
+
+        state.Write<uint64_t>(handed.size());
+        const std::span<const char> handedState = connections.Get();
+        std::vector<char> message(state.Get().begin(), state.Get().end());
+        message.insert(message.end(), handedState.begin(), handedState.end());
+
+        // Until the successor confirms, the sockets are still ours. One that dies or doesn't confirm in time is given up
+        // on; it only uses the sockets once we answer its confirmation, so both never serve them.
+        if(!successor.Send(message) || !successor.Receive(header, buffer, HandOffTimeout))
+        {
+            Log<LogLevel::Warning>("Process {} didn't take over, carrying on.", processID);
+            for(const auto& [client, queued] : handed)
+                client->Requeue(queued);
+            return false;
+        }
+
+        // Our handles only, the sockets stay open through the successor's.
+        for(ClientConnection& client : _clients)
+        {
+            _timers.Cancel(client._timer);
+            client.Close();
+        }
+        _leaving.splice(_leaving.end(), _clients);
+        PublishMembership();
+        _connectionsPerAddress.clear();
+        for(PeerNode& peer : _peerNodes)
+            peer.Link = nullptr;
+        _handOvers.clear();
+        _listeners.clear();
+        _restartListener.reset();
+        // The successor keeps the same files, it has to be the only one writing them. Still under rooms, so no
+        // broadcast is logging.
+        _store.reset();
+        IConnection::Close();
+
+        _isHandedOff = true;
+        _shouldClose = true;
+
+        // The path is free now, the successor can listen on it for the next restart.
+        std::ignore = successor.Send(std::span<const char>(reinterpret_cast<const char*>(&RestartMagic), sizeof(RestartMagic)));
+
+        Log<LogLevel::Info>("Handed {} connections off to process {}.", handed.size(), processID);
+        return true;
+    }
+
+    bool Server::TakeOver(std::string_view path)
+    {
+        std::unique_ptr<ITransport> transport = ConnectUnixSocket(path);
+        if(!transport)
+            return false;
+
+        IOConnection predecessor(std::move(transport));
+
+        StateWriter request;
+        request.Write(RestartMagic);
+        request.Write<uint32_t>(GetCurrentProcessId());
+
+        MessageHeader header;
+        std::vector<char> buffer;
+        if(!predecessor.Send(request.Get()) || !predecessor.Receive(header, buffer))
+            return false;
+
+        StateReader state(buffer);
+        if(state.Read<uint32_t>() != RestartMagic)
+            return false;
+
+        const uint64_t epoch = state.Read<uint64_t>();
+
+        std::optional<std::pair<WSAPROTOCOL_INFOA, Address>> listening;
+        if(state.Read<uint8_t>())
+        {
+            const WSAPROTOCOL_INFOA info = state.Read<WSAPROTOCOL_INFOA>();
+            listening.emplace(info, state.Read<Address>());
+        }
+
+        std::unordered_map<RoomID, MessageBacklog> rooms;
+        ReadRooms(state, rooms);
+
+        std::unordered_map<RoomID, uint64_t> relaySequences;
+        for(uint64_t count = state.Read<uint64_t>(); count && state.IsValid(); count--)
+        {
+            const RoomID room = state.Read<RoomID>();
+            relaySequences[room] = state.Read<uint64_t>();
+        }
+
+        std::unordered_map<RoomID, uint64_t> importedEpochs;
+        for(uint64_t count = state.Read<uint64_t>(); count && state.IsValid(); count--)
+        {
+            const RoomID room = state.Read<RoomID>();
+            importedEpochs[room] = state.Read<uint64_t>();
+        }
+
+        std::unordered_map<uint64_t, std::unordered_map<RoomID, uint64_t>> relayed;
+        for(uint64_t count = state.Read<uint64_t>(); count && state.IsValid(); count--)
+        {
+            const uint64_t origin = state.Read<uint64_t>();
+            const RoomID room = state.Read<RoomID>();
+            relayed[origin][room] = state.Read<uint64_t>();
+        }
+
+        std::vector<HandedConnection> connections;
+        for(uint64_t count = state.Read<uint64_t>(); count && state.IsValid(); count--)
+        {
+            HandedConnection& connection = connections.emplace_back();
+            connection.Info = state.Read<WSAPROTOCOL_INFOA>();
+            connection.Target = state.Read<Address>();
+            connection.Flags = state.Read<uint8_t>();
+            if(connection.Flags & static_cast<uint8_t>(HandedFlags::Listened))
+                connection.Listener = std::make_shared<const ListenerOptions>(state.Read<ListenerOptions>());
+
+            for(uint64_t rooms = state.Read<uint64_t>(); rooms && state.IsValid(); rooms--)
+                connection.Rooms.push_back(state.Read<RoomID>());
+
+            const std::span<const char> unsent = state.ReadBytes();
+            connection.Unsent.assign(unsent.begin(), unsent.end());
+
+            for(uint64_t frames = state.Read<uint64_t>(); frames && state.IsValid(); frames--)
+            {
+                const MessagePriority priority = state.Read<MessagePriority>();
+                const std::span<const char> frame = state.ReadBytes();
+                connection.Queued.emplace_back(priority, std::make_shared<const std::vector<char>>(frame.begin(), frame.end()));
+            }
+
+            const std::span<const char> inbound = state.ReadBytes();
+            connection.Inbound.assign(inbound.begin(), inbound.end());
+        }
+
+        if(!state.IsValid())
+        {
+            Log<LogLevel::Error>("Malformed hot restart state from {}.", path);
+            return false;
+        }
+
+        // Opened before confirming, so a failure leaves the predecessor in charge of everything.
+        const auto closeAll = [&](SOCKET listeningSocket)
+        {
+            closesocket(listeningSocket);
+            for(const HandedConnection& connection : connections)
+                closesocket(connection.Socket);
+        };
+
+        const SOCKET listeningSocket = listening ? Open(listening->first) : InvalidSocket;
+        for(HandedConnection& connection : connections)
+            connection.Socket = Open(connection.Info);
+
+        // The predecessor answers once it has let go of everything, the path included, after which it may be listened
+        // on again. One that gave up waiting on us closes instead and keeps serving.
+        if((listening && listeningSocket == InvalidSocket) ||
+            !predecessor.Send(std::span<const char>(reinterpret_cast<const char*>(&RestartMagic), sizeof(RestartMagic))) ||
+            !predecessor.Receive(header, buffer))
+        {
+            Log<LogLevel::Error>("Failed to take over from {}.", path);
+            closeAll(listeningSocket);
+            return false;
+        }
+
+        {
+            std::scoped_lock lock{ _state };
+
+            if(listening)
+            {
+                Socket_ = listeningSocket;
+                Address_ = listening->second;
+            }
+
+            _epoch = epoch;
+            _relayed = std::move(relayed);
+            {
+                std::scoped_lock roomLock{ _roomState };
+                RestoreRooms(std::move(rooms));
+                for(const auto& [room, sequence] : relaySequences)
+                    if(const auto restored = _rooms.find(room); restored != _rooms.end())
+                        restored->second->RelaySequence = sequence;
+            }
+            _importedEpochs = std::move(importedEpochs);
+
+            const auto now = std::chrono::steady_clock::now();
+            for(HandedConnection& connection : connections)
+            {
+                // Closed by the predecessor's duplicate handle going away, the client reconnects.
+                if(connection.Socket == InvalidSocket)
+                    continue;
+
+                Address counted = connection.Target;
+                counted.Port = 0;
+                _connectionsPerAddress[counted]++;
+
+                _clients.push_back(ClientConnection(connection.Socket, connection.Target));
+
+                ClientConnection& client = _clients.back();
+                client._isHandshaken = connection.Flags & static_cast<uint8_t>(HandedFlags::Handshaken);
+                client._isPeer = connection.Flags & static_cast<uint8_t>(HandedFlags::Peer);
+                client._isDialed = connection.Flags & static_cast<uint8_t>(HandedFlags::Dialed);
+                client._isPingPending = connection.Flags & static_cast<uint8_t>(HandedFlags::PingPending);
+                client._rooms = std::move(connection.Rooms);
+                client._lastReceived = now;
+                client._listener = std::move(connection.Listener);
+                client._rateLimiter = client._isPeer ? RateLimiter() : RateLimiter(GetRateLimit(client), now);
+                client.SetUnsent(std::move(connection.Unsent));
+                client.Requeue(connection.Queued);
+                client.SetInbound(std::move(connection.Inbound));
+
+                ScheduleConnectionTimer(client, now + (client._isHandshaken ? _options.HeartbeatInterval : _options.HandshakeTimeout), std::prev(_clients.end()));
+
+                if(!client._isDialed)
+                    OnConnect(client);
+            }
+
+            PublishMembership();
+            Log<LogLevel::Info>("Took over {} connections and {} rooms from {}.", _clients.size(), _rooms.size(), path);
+        }
+
+        return true;
+    }
+}
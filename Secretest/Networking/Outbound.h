@@ -0,0 +1,155 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#pragma once
+
+#include "Protocol.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace Secretest
+{
+    enum class MessagePriority : uint8_t
+    {
+        // Session, resume and heartbeats. Always first.
+        Control,
+        // Live chat, and chat relayed between nodes.
+        Interactive,
+        // History replay and anything else that can wait.
+        Bulk
+    };
+
+    constexpr MessagePriority GetPriority(MessageType type)
+    {
+        return type == MessageType::Data || type == MessageType::Relay ? MessagePriority::Interactive : MessagePriority::Control;
+    }
+
+    // Header and payload back to back. A broadcast serializes it once and queues the same one for every member.
+    using SharedFrame = std::shared_ptr<const std::vector<char>>;
+
+    inline SharedFrame MakeFrame(const MessageHeader& header, std::span<const char> payload)
+    {
+        std::vector<char> frame(sizeof(header) + payload.size_bytes());
+        std::memcpy(frame.data(), &header, sizeof(header));
+        std::memcpy(frame.data() + sizeof(header), payload.data(), payload.size_bytes());
+        return std::make_shared<const std::vector<char>>(std::move(frame));
+    }
+
+    // Outbound frames of one connection, in three lanes. Control goes out strictly first; interactive and bulk
+    // share what is left by deficit round robin, each lane's quantum being the bytes it may send per round.
+    // Not thread safe.
+    class OutboundQueue
+    {
+    public:
+        explicit OutboundQueue(uint32_t interactiveQuantum = 16 * 1024, uint32_t bulkQuantum = 4 * 1024) :
+            _quantum{ 0, std::max(interactiveQuantum, 1u), std::max(bulkQuantum, 1u) }
+        {}
+
+        // Starts with a whole header.
+        void Push(MessagePriority priority, SharedFrame data)
+        {
+            MessageHeader header;
+            std::memcpy(&header, data->data(), sizeof(header));
+
+            // A room's frames have to arrive in sequence order, clients drop anything at or below the last one seen.
+            // Live frames for a room still being replayed wait behind the replay.
+            if(header.Sequence && priority == MessagePriority::Interactive && _bulkRooms.contains(header.Room))
+                priority = MessagePriority::Bulk;
+            if(header.Sequence && priority == MessagePriority::Bulk)
+                _bulkRooms[header.Room]++;
+
+            Lane& lane = _lanes[static_cast<size_t>(priority)];
+            lane.Bytes += data->size();
+            lane.Frames.push_back(Frame{ std::move(data), header.Room, header.Sequence != 0 });
+        }
+
+        // Null if nothing is queued.
+        // Bulk frames are only handed out while allowBulk is set, or when they are owed their share.
+        SharedFrame Pop(bool allowBulk, MessagePriority& priority)
+        {
+            Lane& control = _lanes[static_cast<size_t>(MessagePriority::Control)];
+            if(!control.Frames.empty())
+                return Take(MessagePriority::Control, priority);
+
+            const bool hasInteractive = !_lanes[static_cast<size_t>(MessagePriority::Interactive)].Frames.empty();
+            const bool hasBulk = !_lanes[static_cast<size_t>(MessagePriority::Bulk)].Frames.empty();
+
+            if(!hasBulk)
+                return hasInteractive ? Take(MessagePriority::Interactive, priority) : nullptr;
+            if(!hasInteractive)
+                return allowBulk ? Take(MessagePriority::Bulk, priority) : nullptr;
+
+            // Both waiting: the lane whose turn it is sends while its deficit covers the next frame.
+            while(true)
+            {
+                Lane& lane = _lanes[static_cast<size_t>(_turn)];
+                const size_t size = lane.Frames.front().Data->size();
+
+                if(lane.Deficit >= size)
+                {
+                    lane.Deficit -= size;
+                    return Take(_turn, priority);
+                }
+
+                _turn = _turn == MessagePriority::Interactive ? MessagePriority::Bulk : MessagePriority::Interactive;
+                _lanes[static_cast<size_t>(_turn)].Deficit += _quantum[static_cast<size_t>(_turn)];
+            }
+        }
+
+        [[nodiscard]] bool IsEmpty() const { return std::ranges::all_of(_lanes, [](const Lane& lane) { return lane.Frames.empty(); }); }
+        [[nodiscard]] size_t GetQueuedBytes(MessagePriority priority) const { return _lanes[static_cast<size_t>(priority)].Bytes; }
+        [[nodiscard]] size_t GetQueuedBytes() const { return _lanes[0].Bytes + _lanes[1].Bytes + _lanes[2].Bytes; }
+
+    private:
+        struct Frame
+        {
+            SharedFrame Data;
+            RoomID Room;
+            bool IsSequenced;
+        };
+
+        struct Lane
+        {
+            std::deque<Frame> Frames;
+            size_t Bytes = 0;
+            size_t Deficit = 0;
+        };
+
+        SharedFrame Take(MessagePriority priority, MessagePriority& taken)
+        {
+            taken = priority;
+
+            Lane& lane = _lanes[static_cast<size_t>(priority)];
+
+            Frame frame = std::move(lane.Frames.front());
+            lane.Frames.pop_front();
+            lane.Bytes -= frame.Data->size();
+
+            // An idle lane doesn't bank credit.
+            if(lane.Frames.empty())
+                lane.Deficit = 0;
+
+            if(priority == MessagePriority::Bulk && frame.IsSequenced)
+                if(const auto room = _bulkRooms.find(frame.Room); room != _bulkRooms.end() && !--room->second)
+                    _bulkRooms.erase(room);
+
+            return std::move(frame.Data);
+        }
+
+        std::array<Lane, 3> _lanes;
+        std::array<uint32_t, 3> _quantum;
+        MessagePriority _turn = MessagePriority::Interactive;
+
+        // Sequenced bulk frames queued per room.
+        std::unordered_map<RoomID, uint32_t> _bulkRooms;
+    };
+}
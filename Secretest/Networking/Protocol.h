@@ -0,0 +1,360 @@
+//
+// Created by scion on 1/22/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Secretest
+{
+    using RoomID = uint32_t;
+
+    constexpr RoomID DefaultRoom = 0;
+
+    enum class MessageType : uint8_t
+    {
+        Data,
+        // Server to client, sent on accept. Identifies the server instance sequence numbers belong to.
+        Session,
+        // Client to server, asks for every frame in a room after the last sequence the client saw.
+        // Always the first thing a client sends; it completes the handshake.
+        Resume,
+        // Server to client heartbeat, answered with a Pong carrying the same payload.
+        Ping,
+        Pong,
+        // Server to server, the first frame on a federation link. Names the node that dialed.
+        Hello,
+        // Server to server, a room message one of the origin node's clients sent. Never forwarded any further.
+        Relay,
+        // Server to client, the room it joined first lives on another node now. The client reconnects there.
+        Redirect,
+        // Server to server, a room's history handed to the node that owns it now.
+        Migrate
+    };
+
+    struct MessageHeader
+    {
+        MessageHeader() = default;
+        explicit MessageHeader(size_t size, MessageType type = MessageType::Data, RoomID room = DefaultRoom, uint64_t sequence = 0) :
+            SizeChecksum(CalculateChecksum(size)),
+            Type(type),
+            Room(room),
+            Size(size),
+            Sequence(sequence)
+        {};
+
+        [[nodiscard]] bool IsValid() const
+        {
+            return SizeChecksum == CalculateChecksum(Size) &&
+                   Size > 0 &&
+                   Magic == MagicValue;
+        }
+
+        std::array<char, 3> Magic = MagicValue;
+        uint8_t SizeChecksum = UINT8_MAX;
+        MessageType Type = MessageType::Data;
+        RoomID Room = DefaultRoom;
+        size_t Size = SIZE_MAX;
+        // Per-room, starts at 1. Zero means the frame is not part of a room's history.
+        uint64_t Sequence = 0;
+
+    private:
+        static constexpr uint8_t CalculateChecksum(size_t size) { return size % UINT8_MAX; }
+        static constexpr std::array<char, 3> MagicValue { 'S', 'C', 'K' };
+    };
+
+    class InvalidHeaderException final : public std::exception {};
+
+    // A message is any struct naming its MessageType. Trivially copyable ones go over the wire as-is;
+    // anything else needs a MessageSerializer specialization.
+    template<typename T>
+    concept IsMessage = requires { { T::Type } -> std::convertible_to<MessageType>; };
+
+    template<typename T>
+    struct MessageSerializer
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Message needs a MessageSerializer specialization.");
+
+        static std::span<const char> Serialize(const T& message)
+        {
+            return { reinterpret_cast<const char*>(&message), sizeof(T) };
+        }
+
+        static std::optional<T> Deserialize(std::span<const char> payload)
+        {
+            if(payload.size_bytes() != sizeof(T))
+                return std::nullopt;
+
+            // Payloads aren't aligned for T, memcpy is the only legal way in and compiles to plain loads.
+            T message;
+            std::memcpy(&message, payload.data(), sizeof(T));
+            return message;
+        }
+    };
+
+    struct ChatMessage
+    {
+        static constexpr MessageType Type = MessageType::Data;
+
+        // Views the receive buffer, only valid for the duration of the handler.
+        std::string_view Text;
+    };
+
+    template<>
+    struct MessageSerializer<ChatMessage>
+    {
+        static std::span<const char> Serialize(const ChatMessage& message) { return message.Text; }
+        static std::optional<ChatMessage> Deserialize(std::span<const char> payload) { return ChatMessage{ { payload.data(), payload.size() } }; }
+    };
+
+    struct SessionMessage
+    {
+        static constexpr MessageType Type = MessageType::Session;
+
+        uint64_t Epoch;
+    };
+
+    struct ResumeMessage
+    {
+        static constexpr MessageType Type = MessageType::Resume;
+
+        uint64_t Epoch;
+        RoomID Room;
+        uint64_t LastSequence;
+    };
+
+    struct PingMessage
+    {
+        static constexpr MessageType Type = MessageType::Ping;
+
+        uint64_t Timestamp;
+    };
+
+    struct PongMessage
+    {
+        static constexpr MessageType Type = MessageType::Pong;
+
+        uint64_t Timestamp;
+    };
+
+    struct HelloMessage
+    {
+        static constexpr MessageType Type = MessageType::Hello;
+
+        uint64_t Node;
+    };
+
+    // The room is the header's.
+    struct RelayMessage
+    {
+        static constexpr MessageType Type = MessageType::Relay;
+
+        // The node whose client sent it, and its place among everything that node relayed.
+        uint64_t Origin;
+        uint64_t Sequence;
+        // Its sequence in the room at the origin, zero if the origin doesn't own the room.
+        uint64_t RoomSequence;
+        // Views the receive buffer, only valid for the duration of the handler.
+        std::string_view Text;
+    };
+
+    // Origin and both sequences, then the text.
+    template<>
+    struct MessageSerializer<RelayMessage>
+    {
+        static std::vector<char> Serialize(const RelayMessage& message)
+        {
+            std::vector<char> payload(PrefixSize + message.Text.size());
+            std::memcpy(payload.data(), &message.Origin, sizeof(message.Origin));
+            std::memcpy(payload.data() + sizeof(message.Origin), &message.Sequence, sizeof(message.Sequence));
+            std::memcpy(payload.data() + 2 * sizeof(uint64_t), &message.RoomSequence, sizeof(message.RoomSequence));
+            std::memcpy(payload.data() + PrefixSize, message.Text.data(), message.Text.size());
+            return payload;
+        }
+
+        static std::optional<RelayMessage> Deserialize(std::span<const char> payload)
+        {
+            if(payload.size_bytes() < PrefixSize)
+                return std::nullopt;
+
+            RelayMessage message;
+            std::memcpy(&message.Origin, payload.data(), sizeof(message.Origin));
+            std::memcpy(&message.Sequence, payload.data() + sizeof(message.Origin), sizeof(message.Sequence));
+            std::memcpy(&message.RoomSequence, payload.data() + 2 * sizeof(uint64_t), sizeof(message.RoomSequence));
+            message.Text = { payload.data() + PrefixSize, payload.size() - PrefixSize };
+            return message;
+        }
+
+    private:
+        static constexpr size_t PrefixSize = 3 * sizeof(uint64_t);
+    };
+
+    struct RedirectMessage
+    {
+        static constexpr MessageType Type = MessageType::Redirect;
+
+        // Laid out like Address, port included.
+        bool IsIPv6;
+        std::array<uint8_t, 16> IP;
+        uint16_t Port;
+    };
+
+    // The room is the header's.
+    struct MigrateMessage
+    {
+        static constexpr MessageType Type = MessageType::Migrate;
+
+        // The node the room comes from, clients redirected from there resume with its sequences.
+        uint64_t Origin;
+        // Sequence of the first message, the rest follow contiguously.
+        uint64_t FirstSequence;
+        // View the receive buffer, only valid for the duration of the handler.
+        std::vector<std::string_view> Messages;
+    };
+
+    // Origin and first sequence, then every message prefixed with its size.
+    template<>
+    struct MessageSerializer<MigrateMessage>
+    {
+        static std::vector<char> Serialize(const MigrateMessage& message)
+        {
+            size_t size = PrefixSize;
+            for(const std::string_view text : message.Messages)
+                size += sizeof(uint32_t) + text.size();
+
+            std::vector<char> payload(size);
+            std::memcpy(payload.data(), &message.Origin, sizeof(message.Origin));
+            std::memcpy(payload.data() + sizeof(message.Origin), &message.FirstSequence, sizeof(message.FirstSequence));
+
+            char* position = payload.data() + PrefixSize;
+            for(const std::string_view text : message.Messages)
+            {
+                const uint32_t textSize = static_cast<uint32_t>(text.size());
+                std::memcpy(position, &textSize, sizeof(textSize));
+                std::memcpy(position + sizeof(textSize), text.data(), text.size());
+                position += sizeof(textSize) + text.size();
+            }
+            return payload;
+        }
+
+        static std::optional<MigrateMessage> Deserialize(std::span<const char> payload)
+        {
+            if(payload.size_bytes() < PrefixSize)
+                return std::nullopt;
+
+            MigrateMessage message;
+            std::memcpy(&message.Origin, payload.data(), sizeof(message.Origin));
+            std::memcpy(&message.FirstSequence, payload.data() + sizeof(message.Origin), sizeof(message.FirstSequence));
+
+            for(size_t position = PrefixSize; position < payload.size_bytes();)
+            {
+                uint32_t textSize;
+                if(payload.size_bytes() - position < sizeof(textSize))
+                    return std::nullopt;
+                std::memcpy(&textSize, payload.data() + position, sizeof(textSize));
+                position += sizeof(textSize);
+
+                if(payload.size_bytes() - position < textSize)
+                    return std::nullopt;
+                message.Messages.emplace_back(payload.data() + position, textSize);
+                position += textSize;
+            }
+            return message;
+        }
+
+    private:
+        static constexpr size_t PrefixSize = 2 * sizeof(uint64_t);
+    };
+
+    template<IsMessage... MESSAGES>
+    struct MessageSchema
+    {
+        static constexpr bool IsUnique = []() consteval
+        {
+            std::array<bool, 256> seen{};
+            for(const MessageType type : { MESSAGES::Type... })
+                if(std::exchange(seen[static_cast<uint8_t>(type)], true))
+                    return false;
+            return true;
+        }();
+
+        static_assert(IsUnique, "Two messages in a schema share a MessageType.");
+    };
+
+    using ProtocolSchema = MessageSchema<ChatMessage, SessionMessage, ResumeMessage, PingMessage, PongMessage, HelloMessage, RelayMessage,
+        RedirectMessage, MigrateMessage>;
+
+    template<typename SCHEMA_T, typename... ARGS>
+    class MessageDispatcher;
+
+    // Handlers are registered per message type. The header's type byte indexes a table built at compile time,
+    // so dispatch is one indirect call to a thunk that deserializes straight into the handler's type.
+    template<IsMessage... MESSAGES, typename... ARGS>
+    class MessageDispatcher<MessageSchema<MESSAGES...>, ARGS...>
+    {
+    public:
+        template<typename T>
+        using Handler = std::function<void(ARGS..., const T&, const MessageHeader&)>;
+
+        // Handlers may leave off the header.
+        template<typename T, typename FUNC_T> requires (std::is_same_v<T, MESSAGES> || ...)
+        void On(FUNC_T&& func)
+        {
+            if constexpr(std::is_invocable_v<FUNC_T&, ARGS..., const T&, const MessageHeader&>)
+                std::get<Handler<T>>(_handlers) = std::forward<FUNC_T>(func);
+            else
+                std::get<Handler<T>>(_handlers) = [func = std::forward<FUNC_T>(func)](ARGS... args, const T& message, const MessageHeader&) mutable
+                {
+                    func(std::forward<ARGS>(args)..., message);
+                };
+        }
+
+        // False if the type isn't in the schema, nothing handles it, or the payload doesn't deserialize.
+        bool Dispatch(ARGS... args, const MessageHeader& header, std::span<const char> payload) const
+        {
+            return JumpTable[static_cast<uint8_t>(header.Type)](*this, std::forward<ARGS>(args)..., header, payload);
+        }
+
+    private:
+        using Thunk = bool(*)(const MessageDispatcher&, ARGS..., const MessageHeader&, std::span<const char>);
+
+        template<typename T>
+        static bool Invoke(const MessageDispatcher& dispatcher, ARGS... args, const MessageHeader& header, std::span<const char> payload)
+        {
+            const Handler<T>& handler = std::get<Handler<T>>(dispatcher._handlers);
+            if(!handler)
+                return false;
+
+            const std::optional<T> message = MessageSerializer<T>::Deserialize(payload);
+            if(!message)
+                return false;
+
+            handler(std::forward<ARGS>(args)..., *message, header);
+            return true;
+        }
+
+        static bool Unhandled(const MessageDispatcher&, ARGS..., const MessageHeader&, std::span<const char>) { return false; }
+
+        static constexpr std::array<Thunk, 256> JumpTable = []() consteval
+        {
+            std::array<Thunk, 256> table;
+            table.fill(&Unhandled);
+            ((table[static_cast<uint8_t>(MESSAGES::Type)] = &Invoke<MESSAGES>), ...);
+            return table;
+        }();
+
+        std::tuple<Handler<MESSAGES>...> _handlers;
+    };
+}
@@ -0,0 +1,121 @@
+//
+// Created by scion on 1/21/2026.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace Secretest
+{
+    class TokenBucket
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        TokenBucket() = default;
+        // A rate of zero never runs dry.
+        TokenBucket(double rate, double burst, Clock::time_point now) : _rate(rate), _burst(burst), _tokens(burst), _lastRefill(now) {}
+
+        void Refill(Clock::time_point now)
+        {
+            _tokens = std::min(_burst, _tokens + _rate * std::chrono::duration<double>(now - _lastRefill).count());
+            _lastRefill = now;
+        }
+
+        // Allowed to go into debt, a frame is only known to be too big once it has been read.
+        void Consume(double tokens) { if(_rate > 0) _tokens -= tokens; }
+
+        [[nodiscard]] bool IsFull() const { return _tokens >= _burst; }
+        [[nodiscard]] bool IsInDebt() const { return _tokens < 0; }
+
+        [[nodiscard]] Clock::duration GetTimeUntilPaidOff() const
+        {
+            if(!IsInDebt())
+                return Clock::duration::zero();
+            return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(-_tokens / _rate));
+        }
+
+    private:
+        double _rate = 0;
+        double _burst = 0;
+        double _tokens = 0;
+        Clock::time_point _lastRefill;
+    };
+
+    struct RateLimitOptions
+    {
+        double FramesPerSecond = 50;
+        double FrameBurst = 100;
+        double BytesPerSecond = 256 * 1024;
+        double ByteBurst = 1024 * 1024;
+        // A header announcing more is taken as invalid and the client disconnected, before anything is allocated
+        // for the frame. Zero is unlimited. Nodes are exempt, a room's history migrates in one frame.
+        size_t MaxFrameSize = 1024 * 1024;
+
+        // A strike is a frame that put a bucket into debt. Strikes are forgiven once both buckets refill.
+        // Below DropAfterStrikes, reads are delayed until the debt is paid off.
+        // From here on the client's data frames are read and thrown away instead of dispatched.
+        uint32_t DropAfterStrikes = 16;
+        // Reaching this disconnects the client and quarantines its address.
+        uint32_t DisconnectAfterStrikes = 64;
+        // The address is refused for this long after being disconnected for flooding.
+        std::chrono::milliseconds QuarantineTime = std::chrono::minutes(1);
+
+        // Processes on this host a listener already let in: nothing is metered, so nothing is quarantined either.
+        // Frames are still capped.
+        static RateLimitOptions Local() { return { .FramesPerSecond = 0, .BytesPerSecond = 0 }; }
+    };
+
+    enum class RateLimitAction : uint8_t
+    {
+        Allow,
+        Delay,
+        Drop,
+        Disconnect
+    };
+
+    class RateLimiter
+    {
+    public:
+        RateLimiter() = default;
+        RateLimiter(const RateLimitOptions& options, TokenBucket::Clock::time_point now) :
+            _frames(options.FramesPerSecond, options.FrameBurst, now),
+            _bytes(options.BytesPerSecond, options.ByteBurst, now)
+        {}
+
+        // Reads are held back until then, by the event loop rather than a sleep.
+        [[nodiscard]] bool IsThrottled(TokenBucket::Clock::time_point now) const { return now < _throttledUntil; }
+
+        RateLimitAction OnFrame(const RateLimitOptions& options, size_t size, TokenBucket::Clock::time_point now)
+        {
+            _frames.Refill(now);
+            _bytes.Refill(now);
+
+            if(_frames.IsFull() && _bytes.IsFull())
+                _strikes = 0;
+
+            _frames.Consume(1);
+            _bytes.Consume(size);
+
+            if(!_frames.IsInDebt() && !_bytes.IsInDebt())
+                return RateLimitAction::Allow;
+
+            if(++_strikes >= options.DisconnectAfterStrikes)
+                return RateLimitAction::Disconnect;
+            if(_strikes >= options.DropAfterStrikes)
+                return RateLimitAction::Drop;
+
+            _throttledUntil = now + std::max(_frames.GetTimeUntilPaidOff(), _bytes.GetTimeUntilPaidOff());
+            return RateLimitAction::Delay;
+        }
+
+    private:
+        TokenBucket _frames;
+        TokenBucket _bytes;
+        TokenBucket::Clock::time_point _throttledUntil;
+        uint32_t _strikes = 0;
+    };
+}
@@ -0,0 +1,494 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#include "SharedMemory.h"
+#include "Socket.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <new>
+#include <windows.h>
+
+namespace Secretest
+{
+    struct SharedMemoryTransport::Ring
+    {
+        // Both only grow, a position's offset into the ring is modulo its capacity. Written by one side each.
+        alignas(64) std::atomic<uint64_t> Head;
+        alignas(64) std::atomic<uint64_t> Tail;
+
+        // Set by a side about to sleep, cleared by whoever wakes it.
+        alignas(64) std::atomic<uint32_t> IsReaderWaiting;
+        std::atomic<uint32_t> IsWriterWaiting;
+        std::atomic<uint32_t> IsClosed;
+    };
+
+    // Followed by the bytes of both rings.
+    struct alignas(64) SharedMemoryTransport::Segment
+    {
+        uint32_t Magic;
+        uint32_t Capacity;
+        Ring Rings[2];
+    };
+
+    struct SharedMemoryListener::Mailbox
+    {
+        enum SlotState : uint32_t
+        {
+            Free,
+            // A connecting process is still filling it in.
+            Claimed,
+            Ready
+        };
+
+        struct Slot
+        {
+            std::atomic<uint32_t> State;
+            uint32_t ProcessID;
+            uint64_t Connection;
+        };
+
+        uint32_t Magic;
+        uint32_t ProcessID;
+        std::array<Slot, 64> Slots;
+    };
+
+    namespace
+    {
+        static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free, "Shared between processes.");
+
+        constexpr uint32_t SegmentMagic = 0x53534D54;
+        constexpr uint32_t MailboxMagic = 0x53534D4C;
+
+        constexpr uint32_t MinCapacity = 4 * 1024;
+        constexpr uint32_t MaxCapacity = 64 * 1024 * 1024;
+
+        // Checks of the ring, a pause instruction apart, before sleeping on the event. A few microseconds to a few tens
+        // of them, depending on how long the CPU pauses for.
+        constexpr uint32_t SpinCount = 1024;
+
+        std::atomic<uint64_t> NextConnection = 0;
+
+        std::string GetMailboxName(std::string_view listener)
+        {
+            // Local\ keeps it to the login session, and needs no privileges, unlike Global\.
+            return std::format("Local\\Secretest.{}", listener);
+        }
+
+        std::string GetSegmentName(std::string_view listener, uint32_t processID, uint64_t connection)
+        {
+            return std::format("Local\\Secretest.{}.{}.{}", listener, processID, connection);
+        }
+
+        std::string GetEventName(const std::string& segment, size_t event)
+        {
+            return std::format("{}.{}.{}", segment, event / 2, event % 2 ? "Space" : "Data");
+        }
+
+        void CloseHandles(std::span<void* const> handles)
+        {
+            for(void* handle : handles)
+                if(handle)
+                    CloseHandle(handle);
+        }
+
+        void CopyIn(char* ring, uint32_t capacity, uint64_t position, std::span<const char> data)
+        {
+            const size_t offset = position & (capacity - 1);
+            const size_t first = std::min<size_t>(data.size(), capacity - offset);
+
+            std::memcpy(ring + offset, data.data(), first);
+            std::memcpy(ring, data.data() + first, data.size() - first);
+        }
+
+        void CopyOut(const char* ring, uint32_t capacity, uint64_t position, std::span<char> data)
+        {
+            const size_t offset = position & (capacity - 1);
+            const size_t first = std::min<size_t>(data.size(), capacity - offset);
+
+            std::memcpy(data.data(), ring + offset, first);
+            std::memcpy(data.data() + first, ring, data.size() - first);
+        }
+
+        void Wake(std::atomic<uint32_t>& isWaiting, void* event)
+        {
+            // Only the load on the fast path, the exchange makes sure one sleeper is woken once.
+            if(isWaiting.load(std::memory_order_seq_cst) && isWaiting.exchange(0, std::memory_order_seq_cst))
+                SetEvent(event);
+        }
+    }
+
+    SharedMemoryTransport::SharedMemoryTransport(void* mapping, Segment* segment, uint32_t capacity, size_t out, const std::array<void*, 4>& events, void* peer) :
+        _mapping(mapping),
+        _segment(segment),
+        _capacity(capacity),
+        _in(1 - out),
+        _out(out),
+        _events(events),
+        _peer(peer)
+    {
+    }
+
+    std::unique_ptr<ITransport> SharedMemoryTransport::Connect(std::string_view listener, uint32_t capacity)
+    {
+        void* mailboxMapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, GetMailboxName(listener).c_str());
+        if(!mailboxMapping)
+            return nullptr;
+
+        auto* mailbox = static_cast<SharedMemoryListener::Mailbox*>(MapViewOfFile(mailboxMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedMemoryListener::Mailbox)));
+        if(!mailbox || mailbox->Magic != MailboxMagic)
+        {
+            if(mailbox)
+                UnmapViewOfFile(mailbox);
+            CloseHandle(mailboxMapping);
+            return nullptr;
+        }
+
+        const auto closeMailbox = [&]
+        {
+            UnmapViewOfFile(mailbox);
+            CloseHandle(mailboxMapping);
+        };
+
+        capacity = std::bit_ceil(std::clamp(capacity, MinCapacity, MaxCapacity));
+        const uint64_t size = sizeof(Segment) + 2ull * capacity;
+
+        const uint32_t processID = GetCurrentProcessId();
+        const uint64_t connection = NextConnection.fetch_add(1, std::memory_order_relaxed);
+        const std::string name = GetSegmentName(listener, processID, connection);
+
+        void* mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), name.c_str());
+        if(!mapping || GetLastError() == ERROR_ALREADY_EXISTS)
+        {
+            if(mapping)
+                CloseHandle(mapping);
+            closeMailbox();
+            return nullptr;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        void* peer = OpenProcess(SYNCHRONIZE, FALSE, mailbox->ProcessID);
+
+        std::array<void*, 4> events{};
+        for(size_t i = 0; i < events.size(); i++)
+            events[i] = CreateEventA(nullptr, FALSE, FALSE, GetEventName(name, i).c_str());
+
+        if(!view || !peer || std::ranges::find(events, nullptr) != events.end())
+        {
+            if(view)
+                UnmapViewOfFile(view);
+            CloseHandles(events);
+            CloseHandles(std::array{ mapping, peer });
+            closeMailbox();
+            return nullptr;
+        }
+
+        // The mapping is zeroed, which is every ring empty and open.
+        auto* segment = new(view) Segment{ SegmentMagic, capacity, {} };
+        std::unique_ptr<SharedMemoryTransport> transport(new SharedMemoryTransport(mapping, segment, capacity, 0, events, peer));
+
+        // The listener only looks at a slot once it is ready, by then everything above is in place.
+        for(SharedMemoryListener::Mailbox::Slot& slot : mailbox->Slots)
+        {
+            uint32_t expected = SharedMemoryListener::Mailbox::Free;
+            if(!slot.State.compare_exchange_strong(expected, SharedMemoryListener::Mailbox::Claimed, std::memory_order_acquire))
+                continue;
+
+            slot.ProcessID = processID;
+            slot.Connection = connection;
+            slot.State.store(SharedMemoryListener::Mailbox::Ready, std::memory_order_release);
+
+            closeMailbox();
+            return transport;
+        }
+
+        closeMailbox();
+        return nullptr;
+    }
+
+    std::unique_ptr<ITransport> SharedMemoryTransport::Open(const std::string& name, uint32_t peerProcessID)
+    {
+        void* mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+        if(!mapping)
+            return nullptr;
+
+        // The header first, the capacity says how much to map. Anything implausible is a stale or foreign mapping.
+        uint32_t capacity = 0;
+        if(const auto* header = static_cast<const Segment*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Segment))))
+        {
+            if(header->Magic == SegmentMagic)
+                capacity = header->Capacity;
+            UnmapViewOfFile(header);
+        }
+
+        void* view = capacity >= MinCapacity && capacity <= MaxCapacity && std::has_single_bit(capacity) ?
+            MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Segment) + 2ull * capacity) : nullptr;
+        void* peer = OpenProcess(SYNCHRONIZE, FALSE, peerProcessID);
+
+        std::array<void*, 4> events{};
+        for(size_t i = 0; i < events.size(); i++)
+            events[i] = OpenEventA(SYNCHRONIZE | EVENT_MODIFY_STATE, FALSE, GetEventName(name, i).c_str());
+
+        if(!view || !peer || std::ranges::find(events, nullptr) != events.end())
+        {
+            if(view)
+                UnmapViewOfFile(view);
+            CloseHandles(events);
+            CloseHandles(std::array{ mapping, peer });
+            return nullptr;
+        }
+
+        return std::unique_ptr<ITransport>(new SharedMemoryTransport(mapping, static_cast<Segment*>(view), capacity, 1, events, peer));
+    }
+
+    bool SharedMemoryTransport::Wait(Ring& ring, const std::atomic<uint64_t>& position, uint64_t seen, std::atomic<uint32_t>& isWaiting, void* event)
+    {
+        const auto isReady = [&] { return position.load(std::memory_order_acquire) != seen || ring.IsClosed.load(std::memory_order_acquire); };
+
+        // A peer that is actively exchanging messages usually answers sooner than a sleep and a wakeup take.
+        for(uint32_t i = 0; i < SpinCount; i++)
+        {
+            if(isReady())
+                return true;
+            YieldProcessor();
+        }
+
+        // Announced before the last check: either the other side sees the flag and signals, or this check sees its progress.
+        isWaiting.store(1, std::memory_order_seq_cst);
+        if(isReady())
+        {
+            isWaiting.store(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        const HANDLE handles[] = { event, _peer };
+        if(WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+        {
+            // The peer died without closing, possibly halfway through a frame.
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool SharedMemoryTransport::Read(std::span<char> buf)
+    {
+        Ring& ring = _segment->Rings[_in];
+        const char* data = reinterpret_cast<const char*>(_segment + 1) + _in * _capacity;
+
+        while(!buf.empty())
+        {
+            if(!_isOpen)
+                return false;
+
+            const uint64_t tail = ring.Tail.load(std::memory_order_relaxed);
+            // Clamped, the other process is trusted with the contents of the ring but not with our bounds.
+            const uint64_t available = std::min<uint64_t>(ring.Head.load(std::memory_order_acquire) - tail, _capacity);
+
+            if(!available)
+            {
+                // Whatever was written before the close is still read, so the head is looked at again once closed.
+                if(ring.IsClosed.load(std::memory_order_acquire) && ring.Head.load(std::memory_order_acquire) == tail)
+                    return false;
+
+                if(!Wait(ring, ring.Head, tail, ring.IsReaderWaiting, _events[_in * 2]))
+                    return false;
+                continue;
+            }
+
+            const size_t size = std::min<uint64_t>(available, buf.size());
+            CopyOut(data, _capacity, tail, buf.first(size));
+            buf = buf.subspan(size);
+
+            ring.Tail.store(tail + size, std::memory_order_seq_cst);
+            Wake(ring.IsWriterWaiting, _events[_in * 2 + 1]);
+        }
+
+        return true;
+    }
+
+    bool SharedMemoryTransport::ReadSome(std::span<char> buf, size_t& read)
+    {
+        Ring& ring = _segment->Rings[_in];
+        const char* data = reinterpret_cast<const char*>(_segment + 1) + _in * _capacity;
+
+        read = 0;
+        if(!_isOpen)
+            return false;
+
+        const uint64_t tail = ring.Tail.load(std::memory_order_relaxed);
+        const uint64_t available = std::min<uint64_t>(ring.Head.load(std::memory_order_acquire) - tail, _capacity);
+
+        if(!available)
+            return buf.empty() || !ring.IsClosed.load(std::memory_order_acquire) || ring.Head.load(std::memory_order_acquire) != tail;
+
+        read = std::min<uint64_t>(available, buf.size());
+        CopyOut(data, _capacity, tail, buf.first(read));
+
+        ring.Tail.store(tail + read, std::memory_order_seq_cst);
+        Wake(ring.IsWriterWaiting, _events[_in * 2 + 1]);
+        return true;
+    }
+
+    bool SharedMemoryTransport::Write(std::span<const std::span<const char>> parts)
+    {
+        Ring& ring = _segment->Rings[_out];
+        char* data = reinterpret_cast<char*>(_segment + 1) + _out * _capacity;
+
+        for(std::span<const char> part : parts)
+        {
+            while(!part.empty())
+            {
+                if(!_isOpen || ring.IsClosed.load(std::memory_order_acquire))
+                    return false;
+
+                const uint64_t head = ring.Head.load(std::memory_order_relaxed);
+                const uint64_t tail = ring.Tail.load(std::memory_order_acquire);
+                const uint64_t free = _capacity - std::min<uint64_t>(head - tail, _capacity);
+
+                if(!free)
+                {
+                    if(!Wait(ring, ring.Tail, tail, ring.IsWriterWaiting, _events[_out * 2 + 1]))
+                        return false;
+                    continue;
+                }
+
+                const size_t size = std::min<uint64_t>(free, part.size());
+                CopyIn(data, _capacity, head, part.first(size));
+                part = part.subspan(size);
+
+                ring.Head.store(head + size, std::memory_order_seq_cst);
+                Wake(ring.IsReaderWaiting, _events[_out * 2]);
+            }
+        }
+
+        return true;
+    }
+
+    bool SharedMemoryTransport::WriteSome(std::span<const char> buf, size_t& written)
+    {
+        written = 0;
+
+        // The connecting side writes ring 0.
+        if(_out == 0)
+        {
+            const std::span<const char> parts[] = { buf };
+            if(!Write(parts))
+                return false;
+
+            written = buf.size();
+            return true;
+        }
+
+        Ring& ring = _segment->Rings[_out];
+        char* data = reinterpret_cast<char*>(_segment + 1) + _out * _capacity;
+
+        if(!_isOpen || ring.IsClosed.load(std::memory_order_acquire))
+            return false;
+
+        const uint64_t head = ring.Head.load(std::memory_order_relaxed);
+        const uint64_t tail = ring.Tail.load(std::memory_order_acquire);
+        written = std::min<uint64_t>(_capacity - std::min<uint64_t>(head - tail, _capacity), buf.size());
+        if(!written)
+            return true;
+
+        CopyIn(data, _capacity, head, buf.first(written));
+
+        ring.Head.store(head + written, std::memory_order_seq_cst);
+        Wake(ring.IsReaderWaiting, _events[_out * 2]);
+        return true;
+    }
+
+    bool SharedMemoryTransport::IsReadable() const
+    {
+        const Ring& ring = _segment->Rings[_in];
+        return !_isOpen || ring.IsClosed.load(std::memory_order_acquire) || ring.Head.load(std::memory_order_acquire) != ring.Tail.load(std::memory_order_relaxed);
+    }
+
+    bool SharedMemoryTransport::IsWritable() const
+    {
+        const Ring& ring = _segment->Rings[_out];
+        return ring.Head.load(std::memory_order_relaxed) - ring.Tail.load(std::memory_order_acquire) < _capacity;
+    }
+
+    void SharedMemoryTransport::Close()
+    {
+        if(!_isOpen)
+            return;
+        _isOpen = false;
+
+        for(Ring& ring : _segment->Rings)
+            ring.IsClosed.store(1, std::memory_order_release);
+
+        // Whoever sleeps on either ring, on either side, wakes up to find it closed.
+        for(void* event : _events)
+            SetEvent(event);
+    }
+
+    SharedMemoryTransport::~SharedMemoryTransport()
+    {
+        SharedMemoryTransport::Close();
+
+        UnmapViewOfFile(_segment);
+        CloseHandles(_events);
+        CloseHandles(std::array{ _mapping, _peer });
+    }
+
+    SharedMemoryListener::SharedMemoryListener(std::string_view name) : _name(name)
+    {
+        _mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(Mailbox), GetMailboxName(name).c_str());
+        if(!_mapping)
+            throw ServerCreationException(std::format("Failed to create shared memory listener {}. Code: {}", name, GetLastError()));
+
+        if(GetLastError() == ERROR_ALREADY_EXISTS)
+        {
+            CloseHandle(_mapping);
+            throw ServerCreationException(std::format("Failed to create shared memory listener {}; is there a server already listening?", name));
+        }
+
+        void* view = MapViewOfFile(_mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Mailbox));
+        if(!view)
+        {
+            const DWORD err = GetLastError();
+            CloseHandle(_mapping);
+            throw ServerCreationException(std::format("Failed to map shared memory listener {}. Code: {}", name, err));
+        }
+
+        _mailbox = new(view) Mailbox{ MailboxMagic, static_cast<uint32_t>(GetCurrentProcessId()), {} };
+    }
+
+    std::unique_ptr<ITransport> SharedMemoryListener::Accept(Address& address)
+    {
+        // Round robin from where the last pass stopped, so no slot waits on the ones before it.
+        for(size_t i = 0; i < _mailbox->Slots.size(); i++)
+        {
+            Mailbox::Slot& slot = _mailbox->Slots[_nextSlot];
+            _nextSlot = (_nextSlot + 1) % _mailbox->Slots.size();
+
+            if(slot.State.load(std::memory_order_acquire) != Mailbox::Ready)
+                continue;
+
+            const uint32_t processID = slot.ProcessID;
+            const uint64_t connection = slot.Connection;
+            slot.State.store(Mailbox::Free, std::memory_order_release);
+
+            if(std::unique_ptr<ITransport> transport = SharedMemoryTransport::Open(GetSegmentName(_name, processID, connection), processID))
+            {
+                address = Address::FromProcess(processID);
+                return transport;
+            }
+        }
+
+        return nullptr;
+    }
+
+    SharedMemoryListener::~SharedMemoryListener()
+    {
+        UnmapViewOfFile(_mailbox);
+        CloseHandle(_mapping);
+    }
+}
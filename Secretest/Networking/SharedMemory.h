@@ -0,0 +1,101 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#pragma once
+
+#include "Transport.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Secretest
+{
+    // Transport between processes on the same host: a named file mapping holding one single producer, single consumer
+    // byte ring per direction. An empty or full ring is spun on briefly before sleeping on a named event, and a side
+    // only signals the other's event when it announced it is going to sleep, so a busy stream makes no system calls.
+    class SharedMemoryTransport final : public ITransport
+    {
+    public:
+        // Bytes per direction, rounded up to a power of two.
+        static constexpr uint32_t DefaultCapacity = 1 << 20;
+
+        // Null if nothing listens under that name or the listener has no free slot.
+        // Writes are buffered in the ring until the server picks the connection up.
+        static std::unique_ptr<ITransport> Connect(std::string_view listener, uint32_t capacity = DefaultCapacity);
+
+        SharedMemoryTransport(const SharedMemoryTransport&) = delete;
+        SharedMemoryTransport& operator=(const SharedMemoryTransport&) = delete;
+
+        bool Read(std::span<char> buf) override;
+        bool ReadSome(std::span<char> buf, size_t& read) override;
+        bool Write(std::span<const std::span<const char>> parts) override;
+        // Waits on the connecting side, like a client's blocking socket. The accepting side is a server's and never does.
+        bool WriteSome(std::span<const char> buf, size_t& written) override;
+
+        [[nodiscard]] bool IsReadable() const override;
+        [[nodiscard]] bool IsWritable() const override;
+        [[nodiscard]] bool IsOpen() const override { return _isOpen; }
+
+        void Close() override;
+
+        ~SharedMemoryTransport() override;
+
+    private:
+        friend class SharedMemoryListener;
+
+        struct Ring;
+        struct Segment;
+
+        // The connecting side writes ring 0 and reads ring 1.
+        SharedMemoryTransport(void* mapping, Segment* segment, uint32_t capacity, size_t out, const std::array<void*, 4>& events, void* peer);
+
+        // The accepting side, null if the connecting process already gave up on it.
+        static std::unique_ptr<ITransport> Open(const std::string& name, uint32_t peerProcessID);
+
+        // Until position moves past seen or the ring is closed. False if the peer process is gone.
+        bool Wait(Ring& ring, const std::atomic<uint64_t>& position, uint64_t seen, std::atomic<uint32_t>& isWaiting, void* event);
+
+        void* _mapping;
+        Segment* _segment;
+        uint32_t _capacity;
+        size_t _in;
+        size_t _out;
+
+        // Data and space event of ring 0, then of ring 1.
+        std::array<void*, 4> _events;
+        // Signalled once the other process exits, so a crashed peer can't leave a read hanging.
+        void* _peer;
+
+        bool _isOpen = true;
+    };
+
+    // Takes shared memory connections under a name unique to the login session, "Secretest.<name>".
+    // Anyone in the same session can connect. Peers show up as their process, see Address::FromProcess.
+    class SharedMemoryListener final : public IListener
+    {
+    public:
+        // Throws ServerCreationException if the name is taken.
+        explicit SharedMemoryListener(std::string_view name);
+        SharedMemoryListener(const SharedMemoryListener&) = delete;
+        SharedMemoryListener& operator=(const SharedMemoryListener&) = delete;
+
+        std::unique_ptr<ITransport> Accept(Address& address) override;
+
+        ~SharedMemoryListener() override;
+
+    private:
+        friend class SharedMemoryTransport;
+
+        struct Mailbox;
+
+        std::string _name;
+        void* _mapping;
+        Mailbox* _mailbox;
+        size_t _nextSlot = 0;
+    };
+}
@@ -0,0 +1,217 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#include "SimulatedNetwork.h"
+
+#include <algorithm>
+
+namespace Secretest
+{
+    namespace
+    {
+        // A link losing everything would otherwise retransmit forever.
+        constexpr uint32_t MaxRetransmits = 16;
+    }
+
+    void SimulatedNetwork::Listen(Address address, AcceptHandler onAccept)
+    {
+        std::scoped_lock lock{ _state };
+
+        std::erase_if(_listeners, [&](const auto& listener) { return listener.first == address; });
+        _listeners.emplace_back(address, std::move(onAccept));
+    }
+
+    void SimulatedNetwork::StopListening(Address address)
+    {
+        std::scoped_lock lock{ _state };
+        std::erase_if(_listeners, [&](const auto& listener) { return listener.first == address; });
+    }
+
+    std::unique_ptr<ITransport> SimulatedNetwork::Connect(Address address, const LinkOptions& upstream, const LinkOptions& downstream)
+    {
+        AcceptHandler onAccept;
+        Address peer;
+
+        const auto clientIn = std::make_shared<MemoryPipe>();
+        const auto serverIn = std::make_shared<MemoryPipe>();
+        const auto up = std::make_shared<SimulatedLink>(SimulatedLink{ upstream, serverIn });
+        const auto down = std::make_shared<SimulatedLink>(SimulatedLink{ downstream, clientIn });
+
+        {
+            std::scoped_lock lock{ _state };
+
+            const auto listener = std::ranges::find(_listeners, address, &decltype(_listeners)::value_type::first);
+            if(listener == _listeners.end())
+                return nullptr;
+
+            onAccept = listener->second;
+            peer = Address(10, 0, 0, 1, _nextPort++);
+
+            std::erase_if(_links, [](const std::weak_ptr<SimulatedLink>& link) { return link.expired(); });
+            _links.push_back(up);
+            _links.push_back(down);
+        }
+
+        // Outside the lock, the handler is free to write straight away.
+        onAccept(std::make_unique<MemoryTransport>(serverIn, clientIn, *this, down), peer);
+
+        return std::make_unique<MemoryTransport>(clientIn, serverIn, *this, up);
+    }
+
+    std::function<std::unique_ptr<ITransport>(const Address&)> SimulatedNetwork::GetDialer(const LinkOptions& upstream, const LinkOptions& downstream)
+    {
+        return [this, upstream, downstream](const Address& address) { return Connect(address, upstream, downstream); };
+    }
+
+    void SimulatedNetwork::Send(const std::shared_ptr<SimulatedLink>& link, std::span<const std::span<const char>> parts, bool isClose)
+    {
+        std::scoped_lock lock{ _state };
+
+        const LinkOptions& options = link->Options;
+
+        Packet packet{ {}, _order++, link, {}, isClose };
+        for(const std::span<const char> part : parts)
+            packet.Data.insert(packet.Data.end(), part.begin(), part.end());
+
+        _statistics.Sent++;
+        _statistics.BytesSent += packet.Data.size();
+
+        const Duration serialization = options.BytesPerSecond > 0 ?
+            Duration(static_cast<int64_t>(packet.Data.size() * 1e6 / options.BytesPerSecond)) :
+            Duration::zero();
+
+        link->BusyUntil = std::max(_time, link->BusyUntil) + serialization;
+        packet.Arrival = link->BusyUntil + options.Latency;
+        if(options.Jitter.count() > 0)
+            packet.Arrival += Duration(_random() % (options.Jitter.count() + 1));
+
+        // The peer hears about a close reliably, and only after everything sent before it.
+        if(!isClose)
+        {
+            if(options.IsOrdered)
+            {
+                for(uint32_t i = 0; i < MaxRetransmits && Roll(options.LossRate); i++)
+                {
+                    packet.Arrival += options.RetransmitTimeout;
+                    _statistics.Retransmitted++;
+                }
+            }
+            else if(Roll(options.LossRate))
+            {
+                _statistics.Lost++;
+                return;
+            }
+
+            if(Roll(options.ReorderRate))
+            {
+                packet.Arrival += options.ReorderDelay;
+                _statistics.Reordered++;
+            }
+        }
+
+        // Head-of-line blocking: in order, nothing overtakes what was written before it.
+        if(options.IsOrdered || isClose)
+            packet.Arrival = std::max(packet.Arrival, link->LastArrival);
+        link->LastArrival = std::max(link->LastArrival, packet.Arrival);
+
+        link->BytesInFlight += packet.Data.size();
+        _bytesInFlight += packet.Data.size();
+
+        _inFlight.push_back(std::move(packet));
+        std::ranges::push_heap(_inFlight, std::greater<>());
+    }
+
+    void SimulatedNetwork::Deliver(Duration until)
+    {
+        while(!_inFlight.empty() && _inFlight.front().Arrival <= until)
+        {
+            std::ranges::pop_heap(_inFlight, std::greater<>());
+            Packet packet = std::move(_inFlight.back());
+            _inFlight.pop_back();
+
+            packet.Link->BytesInFlight -= packet.Data.size();
+            _bytesInFlight -= packet.Data.size();
+
+            if(packet.IsClose)
+            {
+                packet.Link->Target->Close();
+                continue;
+            }
+
+            packet.Link->Target->Push(packet.Data);
+
+            _statistics.Delivered++;
+            _statistics.BytesDelivered += packet.Data.size();
+        }
+    }
+
+    bool SimulatedNetwork::HasWindow(const SimulatedLink& link) const
+    {
+        std::scoped_lock lock{ _state };
+        return !link.Options.SendWindow || link.BytesInFlight < link.Options.SendWindow;
+    }
+
+    void SimulatedNetwork::Advance(Duration time)
+    {
+        std::scoped_lock lock{ _state };
+
+        _time += time;
+        Deliver(_time);
+    }
+
+    bool SimulatedNetwork::AdvanceToNext()
+    {
+        std::scoped_lock lock{ _state };
+
+        if(_inFlight.empty())
+            return false;
+
+        _time = std::max(_time, _inFlight.front().Arrival);
+        Deliver(_time);
+        return true;
+    }
+
+    void SimulatedNetwork::DisconnectAll()
+    {
+        std::scoped_lock lock{ _state };
+
+        for(const std::weak_ptr<SimulatedLink>& weak : _links)
+        {
+            const std::shared_ptr<SimulatedLink> link = weak.lock();
+            if(!link)
+                continue;
+
+            link->Target->Close();
+            link->BytesInFlight = 0;
+        }
+
+        _links.clear();
+        _inFlight.clear();
+        _bytesInFlight = 0;
+    }
+
+    SimulatedNetwork::Duration SimulatedNetwork::GetTime() const
+    {
+        std::scoped_lock lock{ _state };
+        return _time;
+    }
+
+    size_t SimulatedNetwork::GetBytesInFlight() const
+    {
+        std::scoped_lock lock{ _state };
+        return _bytesInFlight;
+    }
+
+    NetworkStatistics SimulatedNetwork::GetStatistics() const
+    {
+        std::scoped_lock lock{ _state };
+        return _statistics;
+    }
+
+    bool SimulatedNetwork::Roll(double probability)
+    {
+        // Top 53 bits as a double in [0, 1), the same on every standard library unlike the distributions.
+        return probability > 0 && static_cast<double>(_random() >> 11) * 0x1.0p-53 < probability;
+    }
+}
@@ -0,0 +1,133 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#pragma once
+
+#include "Socket.h"
+#include "Transport.h"
+
+#include <chrono>
+#include <functional>
+#include <random>
+#include <tuple>
+
+namespace Secretest
+{
+    // One direction of a simulated connection. Frames are written whole, so none of this can tear one apart.
+    struct LinkOptions
+    {
+        // One way propagation delay, plus up to Jitter on top, uniformly.
+        std::chrono::microseconds Latency{ 0 };
+        std::chrono::microseconds Jitter{ 0 };
+        // Serialization delay; writes queue behind each other. Zero is unlimited.
+        double BytesPerSecond = 0;
+
+        double LossRate = 0;
+        // A reordered write is held back by ReorderDelay, letting later ones overtake it.
+        double ReorderRate = 0;
+        std::chrono::microseconds ReorderDelay{ 1000 };
+
+        // Stream semantics like TCP: a lost write is retransmitted after RetransmitTimeout
+        // and nothing is delivered past a write that hasn't arrived yet.
+        // Otherwise lost writes are gone and reordered ones arrive out of order.
+        bool IsOrdered = true;
+        std::chrono::microseconds RetransmitTimeout{ 200000 };
+
+        // The sender's transport stops being writable with this much in flight, like a full socket buffer.
+        // Zero is unlimited. Writes still go through, only whoever checks IsWritable waits.
+        size_t SendWindow = 0;
+    };
+
+    struct NetworkStatistics
+    {
+        uint64_t Sent = 0;
+        uint64_t Delivered = 0;
+        uint64_t Lost = 0;
+        uint64_t Retransmitted = 0;
+        uint64_t Reordered = 0;
+        uint64_t BytesSent = 0;
+        uint64_t BytesDelivered = 0;
+    };
+
+    struct SimulatedLink
+    {
+        LinkOptions Options;
+        std::shared_ptr<MemoryPipe> Target;
+
+        // Virtual time the link finishes serializing what was queued, and the last in order arrival.
+        std::chrono::microseconds BusyUntil{ 0 };
+        std::chrono::microseconds LastArrival{ 0 };
+        size_t BytesInFlight = 0;
+    };
+
+    // In-process network on a virtual clock. Nothing arrives until Advance moves time past its
+    // arrival, so a run is the same every time for the same seed and the same sequence of calls.
+    // Transports it hands out refer back to it, it has to outlive them.
+    class SimulatedNetwork
+    {
+    public:
+        using Duration = std::chrono::microseconds;
+        using AcceptHandler = std::function<void(std::unique_ptr<ITransport> transport, Address peer)>;
+
+        explicit SimulatedNetwork(uint64_t seed = 0) : _random(seed) {}
+        SimulatedNetwork(const SimulatedNetwork&) = delete;
+        SimulatedNetwork& operator=(const SimulatedNetwork&) = delete;
+
+        // Connections to address are handed to onAccept, e.g. Server::Adopt.
+        void Listen(Address address, AcceptHandler onAccept);
+        void StopListening(Address address);
+
+        // Null if nothing listens on address, like a refused connect.
+        std::unique_ptr<ITransport> Connect(Address address, const LinkOptions& upstream = {}, const LinkOptions& downstream = {});
+        // Fits ConnectOptions::Dial.
+        std::function<std::unique_ptr<ITransport>(const Address&)> GetDialer(const LinkOptions& upstream = {}, const LinkOptions& downstream = {});
+
+        // Delivers everything due by now + time, in arrival order.
+        void Advance(Duration time);
+        // Advances straight to the next arrival. False if nothing is in flight.
+        bool AdvanceToNext();
+
+        // Drops every connection and everything in flight, like pulling the cable.
+        void DisconnectAll();
+
+        [[nodiscard]] Duration GetTime() const;
+        [[nodiscard]] size_t GetBytesInFlight() const;
+        [[nodiscard]] NetworkStatistics GetStatistics() const;
+
+    private:
+        friend class MemoryTransport;
+
+        struct Packet
+        {
+            Duration Arrival;
+            // Breaks ties so equal arrivals keep send order.
+            uint64_t Order;
+            std::shared_ptr<SimulatedLink> Link;
+            std::vector<char> Data;
+            bool IsClose;
+
+            bool operator>(const Packet& b) const { return std::tie(Arrival, Order) > std::tie(b.Arrival, b.Order); }
+        };
+
+        void Send(const std::shared_ptr<SimulatedLink>& link, std::span<const std::span<const char>> parts, bool isClose);
+        void Deliver(Duration until);
+        [[nodiscard]] bool HasWindow(const SimulatedLink& link) const;
+
+        bool Roll(double probability);
+
+        mutable std::mutex _state;
+        Duration _time{ 0 };
+        uint64_t _order = 0;
+        std::mt19937_64 _random;
+
+        // Min-heap on arrival.
+        std::vector<Packet> _inFlight;
+        std::vector<std::pair<Address, AcceptHandler>> _listeners;
+        std::vector<std::weak_ptr<SimulatedLink>> _links;
+        uint16_t _nextPort = 1;
+        size_t _bytesInFlight = 0;
+
+        NetworkStatistics _statistics;
+    };
+}
@@ -9,13 +9,229 @@
 #include <string>
 #include <winsock2.h>
 #include <ws2tcpip.h>
-#include <print>
+#include <mstcpip.h>
+#include <optional>
+#include <ranges>
+#include <random>
+#include <cmath>
 #include <bits/ranges_algo.h>
 
 using namespace std::string_view_literals;
 
 namespace Secretest
 {
+    namespace
+    {
+        int GetNativeFamily(AddressFamily family)
+        {
+            return family == AddressFamily::IPv4 ? AF_INET : AF_INET6;
+        }
+
+        int ToSockAddr(const Address& address, sockaddr_storage& storage)
+        {
+            storage = {};
+
+            if(address.Family == AddressFamily::IPv4)
+            {
+                sockaddr_in& hint = reinterpret_cast<sockaddr_in&>(storage);
+                hint.sin_family = AF_INET;
+                hint.sin_port = address.Port;
+                hint.sin_addr.S_un.S_addr = address.IP;
+                return sizeof(sockaddr_in);
+            }
+
+            sockaddr_in6& hint = reinterpret_cast<sockaddr_in6&>(storage);
+            hint.sin6_family = AF_INET6;
+            hint.sin6_port = address.Port;
+            std::memcpy(&hint.sin6_addr, address.IPv6Bytes.data(), address.IPv6Bytes.size());
+            return sizeof(sockaddr_in6);
+        }
+
+        Address FromSockAddr(const sockaddr* address)
+        {
+            if(address->sa_family == AF_INET6)
+            {
+                const sockaddr_in6* ipv6 = reinterpret_cast<const sockaddr_in6*>(address);
+
+                std::array<uint8_t, 16> bytes;
+                std::memcpy(bytes.data(), &ipv6->sin6_addr, bytes.size());
+                return Address(bytes, ipv6->sin6_port);
+            }
+
+            const sockaddr_in* ipv4 = reinterpret_cast<const sockaddr_in*>(address);
+            return Address(ipv4->sin_addr.S_un.S_addr, ipv4->sin_port);
+        }
+
+        void SetBlocking(SOCKET socket, bool blocking)
+        {
+            u_long mode = !blocking;
+            ioctlsocket(socket, FIONBIO, &mode);
+        }
+
+        template<typename T>
+        void SetOption(SOCKET socket, int level, int option, T value)
+        {
+            // Best effort, a socket without the option still works.
+            setsockopt(socket, level, option, reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        void ApplySocketOptions(SOCKET socket, const SocketOptions& options)
+        {
+            SetOption<int>(socket, IPPROTO_TCP, TCP_NODELAY, options.NoDelay);
+
+            if(options.QuickAck)
+            {
+#if defined(TCP_QUICKACK)
+                SetOption<int>(socket, IPPROTO_TCP, TCP_QUICKACK, 1);
+#elif defined(SIO_TCP_SET_ACK_FREQUENCY)
+                DWORD frequency = 1, returned = 0;
+                WSAIoctl(socket, SIO_TCP_SET_ACK_FREQUENCY, &frequency, sizeof(frequency), nullptr, 0, &returned, nullptr, nullptr);
+#endif
+            }
+
+            if(options.SendBufferSize)
+                SetOption<int>(socket, SOL_SOCKET, SO_SNDBUF, options.SendBufferSize);
+            if(options.ReceiveBufferSize)
+                SetOption<int>(socket, SOL_SOCKET, SO_RCVBUF, options.ReceiveBufferSize);
+
+#if defined(SO_BUSY_POLL)
+            if(options.BusyPoll.count())
+                SetOption<int>(socket, SOL_SOCKET, SO_BUSY_POLL, options.BusyPoll.count());
+#endif
+
+#if defined(TCP_NOTSENT_LOWAT)
+            if(options.NotSentLowWatermark)
+                SetOption<int>(socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT, options.NotSentLowWatermark);
+#endif
+
+            if(options.KeepAliveIdle.count())
+            {
+                // Per socket timings, SO_KEEPALIVE alone would use the system wide two hours.
+                tcp_keepalive keepAlive
+                {
+                    1,
+                    static_cast<ULONG>(options.KeepAliveIdle.count()),
+                    static_cast<ULONG>(options.KeepAliveInterval.count())
+                };
+
+                DWORD returned = 0;
+                WSAIoctl(socket, SIO_KEEPALIVE_VALS, &keepAlive, sizeof(keepAlive), nullptr, 0, &returned, nullptr, nullptr);
+            }
+        }
+
+        // A peer node that is down stalls the server's loop at most this long per attempt.
+        constexpr std::chrono::milliseconds PeerConnectTimeout{ 250 };
+
+        std::unique_ptr<ITransport> DialSocket(const Address& address, const SocketOptions& options, std::chrono::milliseconds timeout)
+        {
+            const SOCKET connection = socket(GetNativeFamily(address.Family), SOCK_STREAM, IPPROTO_TCP);
+            if(connection == InvalidSocket)
+                return nullptr;
+
+            SetBlocking(connection, false);
+            ApplySocketOptions(connection, options);
+
+            sockaddr_storage hint;
+            const int hintLength = ToSockAddr(address, hint);
+
+            if(connect(connection, reinterpret_cast<const sockaddr*>(&hint), hintLength) == SOCKET_ERROR)
+            {
+                const timeval wait{ static_cast<long>(timeout.count() / 1000), static_cast<long>(timeout.count() % 1000 * 1000) };
+
+                fd_set writeSet{}, exceptionSet{};
+                FD_SET(connection, &writeSet);
+                FD_SET(connection, &exceptionSet);
+
+                int error = 0;
+                int errorLength = sizeof(error);
+
+                if(WSAGetLastError() != WSAEWOULDBLOCK ||
+                   select(0, nullptr, &writeSet, &exceptionSet, &wait) <= 0 ||
+                   FD_ISSET(connection, &exceptionSet) ||
+                   getsockopt(connection, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &errorLength) || error)
+                {
+                    closesocket(connection);
+                    return nullptr;
+                }
+            }
+
+            // Stays non-blocking, the link is read by GetMessages like any accepted socket.
+            SetHandleInformation(reinterpret_cast<HANDLE>(connection), HANDLE_FLAG_INHERIT, 0);
+            return std::make_unique<SocketTransport>(connection);
+        }
+
+        RedirectMessage ToRedirect(const Address& address)
+        {
+            RedirectMessage redirect{};
+            redirect.IsIPv6 = address.Family == AddressFamily::IPv6;
+            redirect.Port = address.Port;
+
+            if(redirect.IsIPv6)
+                redirect.IP = address.IPv6Bytes;
+            else
+                std::memcpy(redirect.IP.data(), address.IPBytes, sizeof(address.IPBytes));
+            return redirect;
+        }
+
+        Address FromRedirect(const RedirectMessage& redirect)
+        {
+            if(redirect.IsIPv6)
+                return Address(redirect.IP, redirect.Port);
+            return Address(redirect.IP[0], redirect.IP[1], redirect.IP[2], redirect.IP[3], redirect.Port);
+        }
+
+        uint64_t ToTick(std::chrono::steady_clock::time_point time, std::chrono::milliseconds resolution)
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()) / resolution;
+        }
+
+        // RFC 8305 section 4: keep the resolver's first family first, then alternate.
+        std::vector<Address> InterleaveFamilies(std::span<const Address> addresses)
+        {
+            std::vector<Address> preferred, other;
+            for(const Address& address : addresses)
+                (address.Family == addresses.front().Family ? preferred : other).push_back(address);
+
+            std::vector<Address> result;
+            for(size_t i = 0; i < std::max(preferred.size(), other.size()); i++)
+            {
+                if(i < preferred.size()) result.push_back(preferred[i]);
+                if(i < other.size()) result.push_back(other[i]);
+            }
+
+            return result;
+        }
+    }
+
+    std::vector<Address> Address::Resolve(std::string_view host, uint16_t port)
+    {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+        hints.ai_flags = AI_ADDRCONFIG;
+
+        addrinfo* info = nullptr;
+        if(getaddrinfo(std::string(host).c_str(), nullptr, &hints, &info))
+            return {};
+
+        std::vector<Address> result;
+        for(const addrinfo* i = info; i; i = i->ai_next)
+        {
+            if(i->ai_family != AF_INET && i->ai_family != AF_INET6)
+                continue;
+
+            Address address = FromSockAddr(i->ai_addr);
+            address.Port = port;
+
+            if(!std::ranges::contains(result, address))
+                result.push_back(address);
+        }
+
+        freeaddrinfo(info);
+        return result;
+    }
+
     SocketContext::SocketContext(uint16_t maxConnections)
     {
         WSADATA wsaData
@@ -37,11 +253,13 @@ namespace Secretest
         WSACleanup();
     }
 
-    IConnection::IConnection(const Address address) : Address_(address)
+    IConnection::IConnection(const Address address, const SocketOptions& options) : Address_(address)
     {
-        Socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        Socket_ = socket(GetNativeFamily(address.Family), SOCK_STREAM, IPPROTO_TCP);
         if(Socket_ == InvalidSocket)
             throw ConnectionCreationException();
+
+        ApplySocketOptions(Socket_, options);
     }
 
     IConnection::IConnection(IConnection&& b) noexcept
@@ -90,280 +308,1600 @@ namespace Secretest
         IConnection::Close();
     }
 
-    ClientConnection::ClientConnection(SOCKET socket)
+    bool SocketTransport::Read(std::span<char> buf)
     {
-        Socket_ = socket;
+        while(!buf.empty())
+        {
+            const int received = recv(_socket, buf.data(), buf.size(), MSG_WAITALL);
+            if(received > 0)
+            {
+                buf = buf.subspan(received);
+                continue;
+            }
+
+            // The server's sockets don't block, a read on one waits here the way a blocking socket would.
+            if(received == 0 || WSAGetLastError() != WSAEWOULDBLOCK || !Wait(false))
+                return false;
+        }
+
+        return true;
+    }
 
-        sockaddr_in address;
-        int addrSize = sizeof(address);
+    bool SocketTransport::ReadSome(std::span<char> buf, size_t& read)
+    {
+        read = 0;
+        if(buf.empty())
+            return true;
 
-        getpeername(socket, reinterpret_cast<sockaddr*>(&address), &addrSize);
+        const int received = recv(_socket, buf.data(), buf.size(), 0);
+        if(received > 0)
+        {
+            read = received;
+            return true;
+        }
 
-        Address_ = Address(address.sin_addr.S_un.S_addr, address.sin_port);
+        // Nothing yet on a non-blocking socket. A blocking one is only read once IsReadable says so.
+        return received == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK;
     }
 
-    bool IOConnection::Receive(std::vector<char>& buf) const
+    bool SocketTransport::Write(std::span<const std::span<const char>> parts)
     {
-        MessageHeader header;
-        bool isOpen = recv(Socket_, reinterpret_cast<char*>(&header), sizeof(header), MSG_WAITALL) > 0;
+        // Gathered into one call, Nagle or not a header never goes out on its own.
+        while(!parts.empty())
+        {
+            std::array<WSABUF, 8> buffers;
+            const size_t count = std::min(parts.size(), buffers.size());
 
-        std::println("Received Packet: Size {}", header.Size);
+            for(size_t i = 0; i < count; i++)
+                buffers[i] = WSABUF{ static_cast<ULONG>(parts[i].size()), const_cast<char*>(parts[i].data()) };
 
-        if(!isOpen || !header.IsValid()) return false;
+            // A non-blocking socket takes what fits in its send buffer, the rest goes once there is room.
+            for(size_t first = 0; first < count;)
+            {
+                DWORD sent = 0;
+                if(WSASend(_socket, buffers.data() + first, count - first, &sent, 0, nullptr, nullptr) == SOCKET_ERROR)
+                {
+                    if(WSAGetLastError() != WSAEWOULDBLOCK || !Wait(true))
+                        return false;
+                    continue;
+                }
 
-        buf.resize(header.Size);
+                for(; first < count && sent >= buffers[first].len; first++)
+                    sent -= buffers[first].len;
+
+                if(first < count)
+                {
+                    buffers[first].buf += sent;
+                    buffers[first].len -= sent;
+                }
+            }
 
-        isOpen = recv(Socket_, buf.data(), header.Size, MSG_WAITALL) > 0;
+            parts = parts.subspan(count);
+        }
 
-        return isOpen;
+        return true;
     }
 
-    bool IOConnection::Send(std::span<const char> buf) const
+    bool SocketTransport::WriteSome(std::span<const char> buf, size_t& written)
     {
-        if(buf.size_bytes() == 0)
+        written = 0;
+        if(buf.empty())
             return true;
 
-        const MessageHeader header(buf.size_bytes());
+        // A blocking socket sends all of it, a non-blocking one what fits in its send buffer.
+        const int sent = send(_socket, buf.data(), static_cast<int>(buf.size()), 0);
+        if(sent != SOCKET_ERROR)
+        {
+            written = sent;
+            return true;
+        }
 
-        return send(Socket_, reinterpret_cast<const char*>(&header), sizeof(header), 0) > 0 &&
-               send(Socket_, buf.data(), buf.size_bytes(), 0) > 0;
+        return WSAGetLastError() == WSAEWOULDBLOCK;
     }
 
-    Client::Client(Address address) : IOConnection(address)
+    bool SocketTransport::Wait(bool isWrite, std::chrono::milliseconds timeout) const
     {
+        const bool isForever = timeout == std::chrono::milliseconds::max();
+        const timeval wait{ static_cast<long>(timeout.count() / 1000), static_cast<long>(timeout.count() % 1000 * 1000) };
+
+        fd_set set{ 1, { _socket } };
+        return select(0, isWrite ? nullptr : &set, isWrite ? &set : nullptr, nullptr, isForever ? nullptr : &wait) > 0;
     }
 
-    void Client::ConnectAsync(uint8_t retryCount, std::chrono::duration<float> retryTime)
+    bool SocketTransport::WaitReadable(std::chrono::milliseconds timeout) const
     {
-        if(IsConnected())
-            return;
+        return Wait(false, timeout);
+    }
 
-        retryCount = std::max<uint8_t>(retryCount, 1);
+    bool SocketTransport::IsReadable() const
+    {
+        static constexpr timeval doNotBlock{ 0, 0 };
 
-        std::thread([=, this]()
-        {
-            for(uint8_t retry = 0; retry < retryCount; retry++)
-            {
-                if(retry)
-                    OnConnectAttempt(retry + 1);
-                InternalConnect();
-                if(IsConnected())
-                    break;
-                std::this_thread::sleep_for(retryTime);
-            }
+        fd_set set{ 1, { _socket } };
 
-            if(!IsConnected())
-                return OnConnectFailure();
-            Listen();
-        }).detach();
+        // An error is reported as readable, the read that follows fails and closes the connection.
+        return select(0, &set, nullptr, nullptr, &doNotBlock) != 0;
     }
 
-    bool Client::Connect()
+    bool SocketTransport::IsWritable() const
     {
-        const bool result = InternalConnect();
-
-        if(result)
-            Listen();
-        else
-            OnConnectFailure();
+        static constexpr timeval doNotBlock{ 0, 0 };
 
-        return result;
+        fd_set set{ 1, { _socket } };
+        return select(0, nullptr, &set, nullptr, &doNotBlock) > 0;
     }
 
-    bool Client::InternalConnect()
+    void SocketTransport::Close()
     {
-        if(_isConnected)
-            return true;
+        if(_socket == InvalidSocket)
+            return;
 
-        sockaddr_in hint{};
-        hint.sin_family = AF_INET;
-        hint.sin_port = GetAddress().Port;
-        hint.sin_addr.S_un.S_addr = GetAddress().IP;
+        closesocket(_socket);
+        _socket = InvalidSocket;
+    }
 
-        _isConnected = connect(Socket_, reinterpret_cast<const sockaddr*>(&hint), sizeof(sockaddr_in)) != SOCKET_ERROR;
+    ClientConnection::ClientConnection(SOCKET socket, Address address) : IOConnection(std::make_unique<SocketTransport>(socket), address)
+    {
+    }
 
-        if(_isConnected)
-            OnConnect();
+    void IOConnection::Close()
+    {
+        if(Transport_)
+            Transport_->Close();
 
-        return _isConnected;
+        IConnection::Close();
     }
 
-    void Client::Listen()
+    bool IOConnection::Receive(MessageHeader& header, std::vector<char>& buf) const
     {
-        if(_isListening)
-            return;
+        if(!Transport_)
+            return false;
 
-        _thread = std::thread([this]()
+        bool isOpen = Transport_->Read(std::span(reinterpret_cast<char*>(&header), sizeof(header)));
+
+        Log<LogLevel::Trace>("Received packet: type {} size {}", static_cast<uint32_t>(header.Type), header.Size);
+
+        if(!isOpen || !header.IsValid()) return false;
+
+        buf.resize(header.Size);
+
+        isOpen = Transport_->Read(buf);
+
+        return isOpen;
+    }
+
+    bool IOConnection::Receive(MessageHeader& header, std::vector<char>& buf, std::chrono::milliseconds timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while(true)
         {
-            {
-                std::unique_lock l{_state};
-                _isListening = true;
-            }
+            bool isReceived = false;
+            if(!TryReceive(header, buf, isReceived, 0))
+                return false;
+            if(isReceived)
+                return true;
+
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if(left <= std::chrono::milliseconds::zero() || !Transport_->WaitReadable(left))
+                return false;
+        }
+    }
 
-            std::vector<char> socketBuffer;
+    bool IOConnection::TryReceive(MessageHeader& header, std::vector<char>& buf, bool& isReceived, size_t maxSize)
+    {
+        isReceived = false;
+        if(!Transport_)
+            return false;
 
-            bool isListening;
-            do
+        // Only what the current frame is missing is read, anything after it is left to flow control.
+        while(true)
+        {
+            size_t frameSize = sizeof(header);
+            if(_inbound.size() >= sizeof(header))
             {
+                std::memcpy(&header, _inbound.data(), sizeof(header));
+                if(!header.IsValid())
+                    return false;
+                if(maxSize && header.Size > maxSize)
                 {
-                    std::unique_lock l{_state};
-                    isListening = _isListening;
+                    Log<LogLevel::Warning>("Frame of {} bytes from {} is over the limit.", header.Size, static_cast<std::string>(Address_));
+                    return false;
                 }
 
-                if(!GetStatus(IConnectionStatusQueryType::Read))
-                    continue;
-
-                if(!IsOpen() || !Receive(socketBuffer))
+                frameSize += header.Size;
+                if(_inbound.size() == frameSize)
                 {
-                    OnDisconnect();
-                    Close();
-                    return;
+                    Log<LogLevel::Trace>("Received packet: type {} size {}", static_cast<uint32_t>(header.Type), header.Size);
+
+                    buf.assign(_inbound.begin() + sizeof(header), _inbound.end());
+                    _inbound.clear();
+                    isReceived = true;
+                    return true;
                 }
+            }
 
-                OnMessage(socketBuffer);
-            } while (isListening);
+            const size_t offset = _inbound.size();
+            _inbound.resize(frameSize);
 
-            std::println("Listening thread exited.");
-        });
-        _thread.detach();
-    }
+            size_t read = 0;
+            const bool isOpen = Transport_->ReadSome(std::span(_inbound).subspan(offset), read);
+            _inbound.resize(offset + read);
 
-    void Client::Join()
-    {
-        {
-            std::scoped_lock lock{ _state };
-            _isListening = false;
+            if(!isOpen)
+                return false;
+            if(!read)
+                return true;
         }
-
-        if(_thread.joinable())
-            _thread.join();
     }
 
-    void Client::Close()
+    bool IOConnection::Send(const MessageHeader& header, std::span<const char> buf, MessagePriority priority) const
     {
-        Join();
+        if(buf.size_bytes() == 0)
+            return true;
 
-        IConnection::Close();
+        if(!Transport_ || !_outbound)
+            return false;
+
+        Queue(header, buf, priority);
+        return Flush(0);
     }
 
-    Client::~Client()
+    void IOConnection::Queue(SharedFrame frame, MessagePriority priority) const
     {
-        Join();
+        if(frame->size() <= sizeof(MessageHeader) || !_outbound)
+            return;
+
+        std::scoped_lock lock{ _outbound->State };
+        _outbound->Queue.Push(priority, std::move(frame));
     }
 
-    Server::Server(uint16_t port) :
-       IConnection(Address(LOCALHOST, port))
+    bool IOConnection::Flush(size_t bulkBudget) const
     {
-        sockaddr_in hint{};
-        hint.sin_family = AF_INET;
-        hint.sin_port = GetAddress().Port;
-        hint.sin_addr.S_un.S_addr = GetAddress().IP;
+        if(!Transport_ || !_outbound)
+            return false;
 
-        if(int err = bind(Socket_, reinterpret_cast<const sockaddr*>(&hint), sizeof(sockaddr_in)); err == SOCKET_ERROR)
-            throw ServerCreationException(std::format("Failed to listen on socket; is there a server already listening? Code: {}", err));
+        std::unique_lock lock{ _outbound->State };
 
-        if(int err = listen(Socket_, SOMAXCONN); err == SOCKET_ERROR)
-            throw ServerCreationException(std::format("Failed to start listening on socket. Code: {}", err));
-    }
+        // Whoever is flushing checks the queue again before letting go.
+        if(_outbound->IsFlushing)
+            return true;
+        _outbound->IsFlushing = true;
 
-    ClientConnection Server::Accept(Address address) const
-    {
-        sockaddr_in hint{};
-        hint.sin_family = AF_INET;
-        hint.sin_port = address.Port;
-        hint.sin_addr.S_un.S_addr = address.IP;
+        bool isOpen = true;
+        while(isOpen)
+        {
+            if(!_outbound->Writing)
+            {
+                const bool allowBulk = bulkBudget && _outbound->Queue.GetQueuedBytes(MessagePriority::Bulk) && Transport_->IsWritable();
 
-        static int hintLength = sizeof(sockaddr_in);
+                MessagePriority priority;
+                _outbound->Writing = _outbound->Queue.Pop(allowBulk, priority);
+                _outbound->Written = 0;
+                if(!_outbound->Writing)
+                    break;
 
-        sockaddr* addr = address.IP ? reinterpret_cast<sockaddr*>(&hint) : nullptr;
-        int* addrSize = address.IP ? &hintLength : nullptr;
+                if(priority == MessagePriority::Bulk)
+                    bulkBudget -= std::min(bulkBudget, _outbound->Writing->size());
+            }
 
-        return ClientConnection(accept(Socket_, addr, addrSize));
-    }
+            // Written outside the lock so other threads can queue meanwhile, one frame at a time.
+            const SharedFrame frame = _outbound->Writing;
+            const size_t offset = _outbound->Written;
 
-    void Server::OnConnect(ClientConnection& connection) {}
+            lock.unlock();
+            size_t written = 0;
+            isOpen = Transport_->WriteSome(std::span(*frame).subspan(offset), written);
+            lock.lock();
 
-    void Server::OnMessage(ClientConnection& connection, std::span<const char> data) {}
+            _outbound->Written += written;
+            // The transport is full, the rest goes on a later flush rather than holding up this thread.
+            if(_outbound->Written < frame->size())
+                break;
 
-    void Server::OnDisconnect(Address address) {}
+            _outbound->Writing = nullptr;
+        }
 
-    void Server::SendToClients(std::span<const char> message) const
-    {
-        for(auto& client : _clients)
-            client.Send(message);
+        _outbound->IsFlushing = false;
+        return isOpen;
     }
 
-    void Server::SendToClientsExcept(std::span<const char> message, std::span<Address> except) const
+    size_t IOConnection::GetQueuedBytes() const
     {
-        for(auto& client : _clients)
-            if(!std::ranges::contains(except, client.GetAddress()))
-                client.Send(message);
+        if(!_outbound)
+            return 0;
+
+        std::scoped_lock lock{ _outbound->State };
+
+        const size_t unsent = _outbound->Writing ? _outbound->Writing->size() - _outbound->Written : 0;
+        return _outbound->Queue.GetQueuedBytes() + unsent;
     }
 
-    void Server::SendToClientsExcept(std::span<const char> message, std::span<ClientConnection*> except) const
+    std::vector<IOConnection::QueuedFrame> IOConnection::TakeQueued() const
     {
-        for(auto& client : _clients)
-            if(!std::ranges::contains(except, &client))
-                client.Send(message);
+        std::vector<QueuedFrame> frames;
+        if(!_outbound)
+            return frames;
+
+        std::scoped_lock lock{ _outbound->State };
+
+        MessagePriority priority;
+        while(SharedFrame frame = _outbound->Queue.Pop(true, priority))
+            frames.emplace_back(priority, std::move(frame));
+        return frames;
     }
 
-    void Server::GetConnections()
+    void IOConnection::Requeue(std::span<const QueuedFrame> frames) const
     {
-        while(GetStatus(IConnectionStatusQueryType::Read) > 0)
+        if(!_outbound)
+            return;
+
+        std::scoped_lock lock{ _outbound->State };
+
+        for(const auto& [priority, frame] : frames)
         {
-            ClientConnection incoming = Accept();
-            _clients.push_back(std::move(incoming));
-            OnConnect(_clients.back());
+            if(frame->size() < sizeof(MessageHeader))
+                continue;
+
+            _outbound->Queue.Push(priority, frame);
         }
     }
 
-    void Server::GetMessages()
+    std::vector<char> IOConnection::GetUnsent() const
     {
-        std::vector<char> socketBuffer;
+        if(!_outbound)
+            return {};
 
-        for(auto client = _clients.begin(); client != _clients.end();)
-        {
-            if(!client->GetStatus(IConnectionStatusQueryType::Read))
-                continue;
+        std::scoped_lock lock{ _outbound->State };
 
-            if(!client->IsOpen() || !client->Receive(socketBuffer))
-            {
-                const Address deleted = client->GetAddress();
-                client->Close();
-                _clients.erase(client++);
-                OnDisconnect(deleted);
-                continue;
-            }
+        if(!_outbound->Writing)
+            return {};
+        return { _outbound->Writing->begin() + _outbound->Written, _outbound->Writing->end() };
+    }
+
+    void IOConnection::SetUnsent(std::vector<char> unsent) const
+    {
+        if(unsent.empty() || !_outbound)
+            return;
 
-            OnMessage(*client, socketBuffer);
+        std::scoped_lock lock{ _outbound->State };
 
-            ++client;
-        }
+        _outbound->Writing = std::make_shared<const std::vector<char>>(std::move(unsent));
+        _outbound->Written = 0;
     }
 
-    void Server::Listen()
+    Client::Client(Address address, ConnectOptions options) : Client(std::vector{ address }, options)
     {
-        _thread = std::thread([this]()
-        {
-            {
-                std::unique_lock l{_state};
+    }
+
+    Client::Client(std::vector<Address> addresses, ConnectOptions options) :
+        _addresses(InterleaveFamilies(addresses)),
+        _options(options)
+    {
+        if(_addresses.empty())
+            throw ConnectionCreationException();
+
+        Address_ = _addresses.front();
+
+        Handlers_.On<SessionMessage>([this](const SessionMessage& session) { OnSession(session); });
+        Handlers_.On<PingMessage>([this](const PingMessage& ping) { std::ignore = Send(PongMessage{ ping.Timestamp }); });
+        Handlers_.On<RedirectMessage>([this](const RedirectMessage& redirect) { OnRedirect(redirect); });
+    }
+
+    void Client::ConnectAsync(uint8_t retryCount, std::chrono::duration<float> retryTime, std::chrono::duration<float> maxRetryTime)
+    {
+        if(IsConnected())
+            return;
+
+        retryCount = std::max<uint8_t>(retryCount, 1);
+
+        std::thread([=, this]()
+        {
+            std::minstd_rand random(std::random_device{}());
+
+            for(uint8_t retry = 0; retry < retryCount; retry++)
+            {
+                if(retry)
+                    OnConnectAttempt(retry + 1);
+                InternalConnect();
+                if(IsConnected() || retry + 1 == retryCount)
+                    break;
+
+                // Full jitter, so clients dropped together don't come back together.
+                const float ceiling = std::min(maxRetryTime.count(), retryTime.count() * std::exp2(static_cast<float>(retry)));
+                std::this_thread::sleep_for(std::chrono::duration<float>(std::uniform_real_distribution(0.f, ceiling)(random)));
+            }
+
+            if(!IsConnected())
+                return OnConnectFailure();
+            Listen();
+        }).detach();
+    }
+
+    bool Client::Connect()
+    {
+        const bool result = InternalConnect();
+
+        if(result)
+            Listen();
+        else
+            OnConnectFailure();
+
+        return result;
+    }
+
+    bool Client::InternalConnect()
+    {
+        if(_isConnected)
+            return true;
+
+        if(_options.Dial)
+            return Dial();
+
+        struct Attempt
+        {
+            SOCKET Socket;
+            Address Target;
+            std::chrono::steady_clock::time_point Deadline;
+        };
+
+        std::vector<Attempt> attempts;
+        SOCKET connected = InvalidSocket;
+        Address connectedAddress;
+
+        auto nextAttempt = _addresses.begin();
+        auto nextAttemptTime = std::chrono::steady_clock::now();
+
+        while(connected == InvalidSocket)
+        {
+            const auto now = std::chrono::steady_clock::now();
+
+            // Start the next address once the previous one had its head start, or right away if nothing is in flight.
+            if(nextAttempt != _addresses.end() && (now >= nextAttemptTime || attempts.empty()))
+            {
+                const Address address = *nextAttempt++;
+                nextAttemptTime = now + _options.AttemptDelay;
+
+                const SOCKET attempt = socket(GetNativeFamily(address.Family), SOCK_STREAM, IPPROTO_TCP);
+                if(attempt == InvalidSocket)
+                    continue;
+
+                SetBlocking(attempt, false);
+                // Before connecting, buffer sizes decide the window scale offered in the handshake.
+                ApplySocketOptions(attempt, _options.Socket);
+
+                sockaddr_storage hint;
+                const int hintLength = ToSockAddr(address, hint);
+
+                if(connect(attempt, reinterpret_cast<const sockaddr*>(&hint), hintLength) != SOCKET_ERROR)
+                {
+                    connected = attempt;
+                    connectedAddress = address;
+                }
+                else if(WSAGetLastError() == WSAEWOULDBLOCK)
+                    attempts.push_back(Attempt{ attempt, address, now + _options.AttemptTimeout });
+                else
+                    closesocket(attempt);
+
+                continue;
+            }
+
+            std::erase_if(attempts, [now](const Attempt& attempt)
+            {
+                if(now < attempt.Deadline)
+                    return false;
+
+                closesocket(attempt.Socket);
+                return true;
+            });
+
+            if(attempts.empty())
+            {
+                if(nextAttempt == _addresses.end())
+                    break;
+                continue;
+            }
+
+            // Wake for whichever comes first: a result, a timeout, or the next address' turn.
+            auto wakeTime = std::ranges::min(attempts, {}, &Attempt::Deadline).Deadline;
+            if(nextAttempt != _addresses.end())
+                wakeTime = std::min(wakeTime, nextAttemptTime);
+
+            const auto wait = std::chrono::duration_cast<std::chrono::microseconds>(std::max(wakeTime - now, std::chrono::steady_clock::duration::zero()));
+            const timeval timeout{ static_cast<long>(wait.count() / 1000000), static_cast<long>(wait.count() % 1000000) };
+
+            // Winsock reports a refused connect through the exception set.
+            fd_set writeSet{}, exceptionSet{};
+            for(const Attempt& attempt : attempts)
+            {
+                FD_SET(attempt.Socket, &writeSet);
+                FD_SET(attempt.Socket, &exceptionSet);
+            }
+
+            if(select(0, nullptr, &writeSet, &exceptionSet, &timeout) <= 0)
+                continue;
+
+            std::erase_if(attempts, [&](const Attempt& attempt)
+            {
+                int error = 0;
+                int errorLength = sizeof(error);
+
+                if(FD_ISSET(attempt.Socket, &exceptionSet) ||
+                   (FD_ISSET(attempt.Socket, &writeSet) && (getsockopt(attempt.Socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &errorLength) || error)))
+                {
+                    closesocket(attempt.Socket);
+                    // A failed path hands its turn to the next address immediately.
+                    nextAttemptTime = now;
+                    return true;
+                }
+
+                if(!FD_ISSET(attempt.Socket, &writeSet) || connected != InvalidSocket)
+                    return false;
+
+                connected = attempt.Socket;
+                connectedAddress = attempt.Target;
+                return true;
+            });
+        }
+
+        for(const Attempt& attempt : attempts)
+            closesocket(attempt.Socket);
+
+        if(connected == InvalidSocket)
+            return false;
+
+        // Receive relies on blocking reads.
+        SetBlocking(connected, true);
+
+        OnConnected(std::make_unique<SocketTransport>(connected), connectedAddress);
+        return true;
+    }
+
+    bool Client::Dial()
+    {
+        for(const Address& address : _addresses)
+        {
+            std::unique_ptr<ITransport> transport = _options.Dial(address);
+            if(!transport)
+                continue;
+
+            OnConnected(std::move(transport), address);
+            return true;
+        }
+
+        return false;
+    }
+
+    void Client::OnConnected(std::unique_ptr<ITransport> transport, Address address)
+    {
+        if(IsOpen())
+            IOConnection::Close();
+
+        Transport_ = std::move(transport);
+        Address_ = address;
+        _isConnected = true;
+
+        SendResume();
+        OnConnect();
+    }
+
+    void Client::OnSession(const SessionMessage& session)
+    {
+        // The server restarted, whatever we had does not line up with its sequences anymore. A node we were
+        // redirected to took the room over with the old node's sequences.
+        const bool isRedirected = std::exchange(_isRedirected, false);
+        if(session.Epoch != _epoch && !isRedirected)
+            _sequences.clear();
+
+        _epoch = session.Epoch;
+    }
+
+    void Client::OnRedirect(const RedirectMessage& redirect)
+    {
+        const Address address = FromRedirect(redirect);
+        Log<LogLevel::Info>("Redirected to {}.", static_cast<std::string>(address));
+
+        // Reconnects go there from now on too.
+        _addresses = { address };
+        _isRedirected = true;
+
+        // Left closed if the node can't be reached, the listening loop reports the disconnect.
+        IOConnection::Close();
+        _isConnected = false;
+        std::ignore = InternalConnect();
+    }
+
+    void Client::SendResume() const
+    {
+        // Doubles as the handshake, so there is always at least one.
+        if(_sequences.empty())
+            std::ignore = Send(ResumeMessage{ _epoch, DefaultRoom, 0 });
+
+        for(const auto& [room, sequence] : _sequences)
+            std::ignore = Send(ResumeMessage{ _epoch, room, sequence });
+    }
+
+    void Client::Listen()
+    {
+        if(_isListening)
+            return;
+
+        _thread = std::thread([this]()
+        {
+            {
+                std::unique_lock l{_state};
+                _isListening = true;
+            }
+
+            MessageHeader header;
+            std::vector<char> socketBuffer;
+            auto lastReceived = std::chrono::steady_clock::now();
+
+            bool isListening;
+            do
+            {
+                {
+                    std::unique_lock l{_state};
+                    isListening = _isListening;
+                }
+
+                // A half-open connection never becomes readable, only the heartbeat going quiet gives it away.
+                const bool isReadable = IsReadable();
+                if(!isReadable && IsOpen() && std::chrono::steady_clock::now() - lastReceived < _options.IdleTimeout)
+                    continue;
+
+                if(!isReadable || !IsOpen() || !Receive(header, socketBuffer))
+                {
+                    {
+                        std::unique_lock l{_state};
+                        _isListening = false;
+                    }
+
+                    Close();
+                    OnDisconnect();
+                    return;
+                }
+
+                lastReceived = std::chrono::steady_clock::now();
+
+                if(header.Sequence)
+                {
+                    uint64_t& sequence = _sequences[header.Room];
+
+                    // Replayed frame we already have.
+                    if(header.Sequence <= sequence)
+                        continue;
+                    sequence = header.Sequence;
+                }
+
+                Handlers_.Dispatch(header, socketBuffer);
+            } while (isListening);
+
+            Log<LogLevel::Debug>("Listening thread exited.");
+        });
+        _thread.detach();
+    }
+
+    void Client::Join()
+    {
+        {
+            std::scoped_lock lock{ _state };
+            _isListening = false;
+        }
+
+        if(_thread.joinable())
+            _thread.join();
+    }
+
+    void Client::Close()
+    {
+        Join();
+
+        IOConnection::Close();
+        _isConnected = false;
+    }
+
+    Client::~Client()
+    {
+        Join();
+    }
+
+    Server::Server(uint16_t port, ServerOptions options) : Server(Address(LOCALHOST, port), options)
+    {
+    }
+
+    Server::Server(Address address, ServerOptions options) :
+       IConnection(address, options.Socket),
+       _options(options),
+       _timers(ToTick(std::chrono::steady_clock::now(), TimerResolution)),
+       _epoch(std::random_device()() | static_cast<uint64_t>(std::random_device()()) << 32 | 1)
+    {
+        if(address.Family == AddressFamily::IPv6)
+        {
+            constexpr DWORD dualStack = 0;
+            setsockopt(Socket_, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char*>(&dualStack), sizeof(dualStack));
+        }
+
+        sockaddr_storage hint;
+        const int hintLength = ToSockAddr(GetAddress(), hint);
+
+        if(int err = bind(Socket_, reinterpret_cast<const sockaddr*>(&hint), hintLength); err == SOCKET_ERROR)
+            throw ServerCreationException(std::format("Failed to listen on socket; is there a server already listening? Code: {}", err));
+
+        if(int err = listen(Socket_, SOMAXCONN); err == SOCKET_ERROR)
+            throw ServerCreationException(std::format("Failed to start listening on socket. Code: {}", err));
+
+        // Accepting drains the backlog until it would block instead of asking select first.
+        SetBlocking(Socket_, false);
+
+        RegisterHandlers();
+    }
+
+    Server::Server(ServerOptions options) :
+       _options(options),
+       _timers(ToTick(std::chrono::steady_clock::now(), TimerResolution)),
+       _epoch(std::random_device()() | static_cast<uint64_t>(std::random_device()()) << 32 | 1)
+    {
+        RegisterHandlers();
+    }
+
+    void Server::Adopt(std::unique_ptr<ITransport> transport, Address address)
+    {
+        std::scoped_lock lock{ _adoptedState };
+        _adopted.push_back(ClientConnection(std::move(transport), address));
+    }
+
+    void Server::AddListener(std::unique_ptr<IListener> listener, ListenerOptions options)
+    {
+        std::scoped_lock lock{ _state };
+        _listeners.emplace_back(std::move(listener), std::make_shared<const ListenerOptions>(options));
+    }
+
+    void Server::AddPeer(Address address)
+    {
+        std::scoped_lock lock{ _state };
+        PeerNode& peer = _peerNodes.emplace_back(PeerNode{ address });
+
+        // A link a predecessor dialed carries on as this one's.
+        for(const ClientConnection& client : _clients)
+            if(!peer.Link && client._isDialed && client.GetAddress() == address && !std::ranges::contains(_peerNodes, &client, &PeerNode::Link))
+                peer.Link = &client;
+    }
+
+    void Server::SetRing(HashRing<Address> ring, Address self)
+    {
+        std::scoped_lock lock{ _state };
+        // Broadcasts on other threads carry on with whichever ring they started with.
+        _ring.Publish(std::make_unique<const Ring>(Ring{ std::move(ring), self }));
+        _isRebalancing = true;
+        _nextRebalance = {};
+    }
+
+    void Server::EnablePersistence(std::string path)
+    {
+        auto store = std::make_unique<StateStore>(path);
+
+        std::scoped_lock lock{ _state, _roomState };
+
+        if(_rooms.empty())
+        {
+            std::unordered_map<RoomID, MessageBacklog> rooms;
+            // Tokens from before the restart are honoured like those of a room handed over from another node.
+            if(const uint64_t epoch = store->Load(rooms))
+                for(const RoomID room : rooms | std::views::keys)
+                    _importedEpochs[room] = epoch;
+
+            RestoreRooms(std::move(rooms));
+            Log<LogLevel::Info>("Restored {} rooms from {}.", _rooms.size(), path);
+        }
+
+        // Starts this process' own log, whatever was loaded is replayed from the snapshot from then on.
+        if(!store->BeginSnapshot(_epoch))
+            throw ServerCreationException(std::format("Failed to write to {}.", path));
+        store->EndSnapshot(_epoch, SnapshotRooms());
+
+        _store = std::move(store);
+    }
+
+    void Server::RegisterHandlers()
+    {
+        Handlers_.On<ResumeMessage>([this](ClientConnection& client, const ResumeMessage& resume)
+        {
+            client._isHandshaken = true;
+
+            // Clients live on the node owning their first room, any other room reaches them over relays. Checked first,
+            // a client that is sent on never joins here.
+            if(client._rooms.empty() || resume.Room == client._rooms.front())
+            {
+                const auto ring = _ring.Read();
+                if(!ring->IsOwner(resume.Room))
+                {
+                    std::ignore = client.Send(ToRedirect(*ring->Nodes.GetOwner(resume.Room)));
+                    return;
+                }
+            }
+
+            // Already a member, nothing to publish. Replayed under the room's lock, so a broadcast lands either in the
+            // replay or after it.
+            if(std::ranges::contains(client._rooms, resume.Room))
+            {
+                std::shared_lock rooms{ _roomState };
+                if(const auto room = _rooms.find(resume.Room); room != _rooms.end())
+                {
+                    std::scoped_lock lock{ room->second->State };
+                    OnResume(client, resume, room->second->Backlog);
+                }
+                return;
+            }
+
+            _joining.emplace_back(&client, resume);
+        });
+
+        Handlers_.On<HelloMessage>([this](ClientConnection& client, const HelloMessage& hello) { OnHello(client, hello); });
+        Handlers_.On<RelayMessage>([this](ClientConnection& client, const RelayMessage& relay, const MessageHeader& header) { OnRelay(client, relay, header.Room); });
+        Handlers_.On<MigrateMessage>([this](ClientConnection& client, const MigrateMessage& migrate, const MessageHeader& header) { OnMigrate(client, migrate, header.Room); });
+
+        // Nodes ping each other like they ping clients, the end that dialed has to answer too.
+        Handlers_.On<PingMessage>([](ClientConnection& client, const PingMessage& ping)
+        {
+            if(client._isPeer)
+                std::ignore = client.Send(PongMessage{ ping.Timestamp });
+        });
+    }
+
+    SOCKET Server::Accept(Address& address) const
+    {
+        sockaddr_storage peer{};
+        int peerLength = sizeof(peer);
+
+        const SOCKET socket = accept(Socket_, reinterpret_cast<sockaddr*>(&peer), &peerLength);
+        if(socket != InvalidSocket)
+            address = FromSockAddr(reinterpret_cast<const sockaddr*>(&peer));
+
+        return socket;
+    }
+
+    bool Server::Admit(Address address, uint32_t maxConnectionsPerAddress)
+    {
+        address.Port = 0;
+
+        if(_options.MaxConnections && _clients.size() >= _options.MaxConnections)
+            return false;
+
+        if(maxConnectionsPerAddress)
+        {
+            const auto count = _connectionsPerAddress.find(address);
+            if(count != _connectionsPerAddress.end() && count->second >= maxConnectionsPerAddress)
+                return false;
+        }
+
+        return !IsQuarantined(address);
+    }
+
+    const RateLimitOptions& Server::GetRateLimit(const ClientConnection& client) const
+    {
+        return client._listener ? client._listener->RateLimit : _options.RateLimit;
+    }
+
+    void Server::AddClient(ClientConnection&& connection)
+    {
+        Address address = connection.GetAddress();
+        address.Port = 0;
+        _connectionsPerAddress[address]++;
+
+        _clients.push_back(std::move(connection));
+
+        ClientConnection& client = _clients.back();
+        client._lastReceived = std::chrono::steady_clock::now();
+        client._rateLimiter = RateLimiter(GetRateLimit(client), client._lastReceived);
+        ScheduleConnectionTimer(client, client._lastReceived + _options.HandshakeTimeout, std::prev(_clients.end()));
+
+        std::ignore = client.Send(SessionMessage{ _epoch });
+        OnConnect(client);
+    }
+
+    void Server::OnConnect(ClientConnection& connection) {}
+
+    void Server::OnDisconnect(Address address) {}
+
+    void Server::SendToClients(std::span<const char> message)
+    {
+        Broadcast(DefaultRoom, message, [](const ClientConnection&) { return false; });
+    }
+
+    void Server::SendToClientsExcept(std::span<const char> message, std::span<Address> except)
+    {
+        Broadcast(DefaultRoom, message, [except](const ClientConnection& client) { return std::ranges::contains(except, client.GetAddress()); });
+    }
+
+    void Server::SendToClientsExcept(std::span<const char> message, std::span<ClientConnection*> except)
+    {
+        Broadcast(DefaultRoom, message, [except](const ClientConnection& client) { return std::ranges::contains(except, &client); });
+    }
+
+    template<typename EXCEPT_T>
+    void Server::Broadcast(RoomID room, std::span<const char> message, EXCEPT_T isExcepted)
+    {
+        // Every member gets a room's frames in sequence order, so numbering and queueing go together. The membership is
+        // read under the room's lock too, a client joining gets either this frame or the replay it is in. Other rooms
+        // only share the room table.
+        std::shared_lock rooms{ _roomState };
+        Room& state = AcquireRoom(room, rooms);
+        std::unique_lock lock{ state.State };
+
+        const auto membership = _membership.Read();
+        const std::span<const ClientConnection* const> members = membership->GetMembers(room);
+
+        // Serialized once, every member queues the same frame.
+        const MessageHeader header = PushBacklog(room, state, message);
+        const SharedFrame frame = MakeFrame(header, message);
+        for(const ClientConnection* client : members)
+            if(!isExcepted(*client))
+                client->Queue(frame, GetPriority(header.Type));
+
+        if(!membership->Peers.empty())
+        {
+            const RelayMessage relay{ _epoch, ++state.RelaySequence, header.Sequence, std::string_view(message.data(), message.size()) };
+            const auto& serialized = MessageSerializer<RelayMessage>::Serialize(relay);
+            const std::span<const char> payload(serialized);
+            const SharedFrame relayFrame = MakeFrame(MessageHeader(payload.size_bytes(), RelayMessage::Type, room), payload);
+
+            for(const ClientConnection* peer : membership->Peers)
+                peer->Queue(relayFrame, GetPriority(RelayMessage::Type));
+        }
+
+        lock.unlock();
+        rooms.unlock();
+
+        // Whoever gets to a connection first writes what everyone queued for it.
+        for(const ClientConnection* client : members)
+            std::ignore = client->Flush(0);
+        for(const ClientConnection* peer : membership->Peers)
+            std::ignore = peer->Flush(0);
+    }
+
+    Server::Room& Server::AcquireRoom(RoomID room, std::shared_lock<std::shared_mutex>& rooms)
+    {
+        while(true)
+        {
+            if(const auto found = _rooms.find(room); found != _rooms.end())
+                return *found->second;
+
+            // Only once per room. It may be gone again by the time the shared lock is back, if it was just handed over.
+            rooms.unlock();
+            {
+                std::scoped_lock lock{ _roomState };
+                if(!_rooms.contains(room))
+                    _rooms.emplace(room, std::make_unique<Room>());
+            }
+            rooms.lock();
+        }
+    }
+
+    MessageHeader Server::PushBacklog(RoomID room, Room& state, std::span<const char> message)
+    {
+        // Anywhere but the owner it only goes out live, the owner's copy is the one clients resume from.
+        if(!_ring.Read()->IsOwner(room))
+            return MessageHeader(message.size_bytes(), MessageType::Data, room);
+
+        const uint64_t sequence = state.Backlog.Push(message);
+        if(_store)
+            _store->LogPush(room, message);
+        return MessageHeader(message.size_bytes(), MessageType::Data, room, sequence);
+    }
+
+    std::vector<RoomSnapshot> Server::SnapshotRooms() const
+    {
+        std::vector<RoomSnapshot> rooms;
+        rooms.reserve(_rooms.size());
+        for(const auto& [room, state] : _rooms)
+            rooms.push_back(RoomSnapshot{ room, state->Backlog.GetSequence(), state->Backlog.GetEntries() });
+        return rooms;
+    }
+
+    void Server::RestoreRooms(std::unordered_map<RoomID, MessageBacklog> rooms)
+    {
+        _rooms.clear();
+        for(auto& [room, backlog] : rooms)
+            _rooms.emplace(room, std::make_unique<Room>()).first->second->Backlog = std::move(backlog);
+    }
+
+    void Server::SnapshotStore()
+    {
+        // Shared, so no room comes or goes before every one is cut.
+        std::shared_lock rooms{ _roomState };
+        if(!_store->BeginSnapshot(_epoch))
+            return;
+
+        std::vector<RoomSnapshot> snapshot;
+        snapshot.reserve(_rooms.size());
+        for(const auto& [room, state] : _rooms)
+        {
+            std::scoped_lock lock{ state->State };
+            snapshot.push_back(RoomSnapshot{ room, state->Backlog.GetSequence(), state->Backlog.GetEntries() });
+            _store->Cut(room);
+        }
+
+        _store->EndSnapshot(_epoch, std::move(snapshot));
+    }
+
+    void Server::OnResume(const ClientConnection& connection, ResumeMessage resume, const MessageBacklog& backlog)
+    {
+        // Fresh client, nothing to catch up on.
+        if(!resume.Epoch)
+            return;
+
+        // Token from a previous server instance, everything we have is new to the client. Unless the room was
+        // handed over from there, its sequences carried over.
+        if(const auto imported = _importedEpochs.find(resume.Room); resume.Epoch != _epoch && (imported == _importedEpochs.end() || imported->second != resume.Epoch))
+            resume.LastSequence = 0;
+
+        // Queued only, nothing is written under the room's lock. Bulk frames go out with the poll's flush anyway.
+        backlog.ForEachAfter(resume.LastSequence, [&](const BacklogEntry& entry)
+        {
+            connection.Queue(MessageHeader(entry.Size, MessageType::Data, resume.Room, entry.Sequence), entry.GetData(), MessagePriority::Bulk);
+        });
+    }
+
+    void Server::Disconnect(ClientIterator client)
+    {
+        const Address deleted = client->GetAddress();
+
+        const auto now = std::chrono::steady_clock::now();
+        for(PeerNode& peer : _peerNodes)
+        {
+            if(peer.Link != &*client)
+                continue;
+
+            peer.Link = nullptr;
+            peer.NextAttempt = now + _options.PeerRetryInterval;
+        }
+
+        // Rooms still waiting on the link stay here, and go again later.
+        if(std::erase_if(_handOvers, [&](const auto& handOver) { return handOver.second == &*client; }))
+        {
+            _isRebalancing = true;
+            _nextRebalance = now + _options.PeerRetryInterval;
+        }
+
+        // A link this node dialed was never announced to OnConnect either.
+        const bool isDialed = client->_isDialed;
+
+        Address counted = deleted;
+        counted.Port = 0;
+        if(const auto count = _connectionsPerAddress.find(counted); count != _connectionsPerAddress.end() && !--count->second)
+            _connectionsPerAddress.erase(count);
+
+        _timers.Cancel(client->_timer);
+        _leaving.splice(_leaving.end(), _clients, client);
+
+        if(!isDialed)
+            OnDisconnect(deleted);
+    }
+
+    void Server::PublishMembership()
+    {
+        std::unique_ptr<Membership> membership = std::make_unique<Membership>();
+        for(const ClientConnection& client : _clients)
+        {
+            if(client._isPeer)
+                membership->Peers.push_back(&client);
+            else
+                for(const RoomID room : client._rooms)
+                    membership->Rooms[room].push_back(&client);
+        }
+        _membership.Publish(std::move(membership));
+
+        // Out of every membership from now on, closed once the broadcasts that read an older one are done.
+        if(!_leaving.empty())
+        {
+            _membership.Retire(std::make_shared<const std::list<ClientConnection>>(std::move(_leaving)));
+            _leaving.clear();
+        }
+    }
+
+    void Server::JoinRooms()
+    {
+        if(_joining.empty())
+            return;
+
+        // Every broadcast holds the room table shared, so none numbers a frame between publishing and replaying; each
+        // joining client gets a frame either in its replay or live. Rooms without history yet can't get their first
+        // message meanwhile either.
+        std::scoped_lock rooms{ _roomState };
+        for(const auto& [client, resume] : _joining)
+            if(!std::ranges::contains(client->_rooms, resume.Room))
+                client->_rooms.push_back(resume.Room);
+        PublishMembership();
+
+        for(const auto& [client, resume] : _joining)
+            if(const auto room = _rooms.find(resume.Room); room != _rooms.end())
+                OnResume(*client, resume, room->second->Backlog);
+        _joining.clear();
+    }
+
+    void Server::ConnectPeers()
+    {
+        const auto now = std::chrono::steady_clock::now();
+
+        for(PeerNode& peer : _peerNodes)
+        {
+            if(peer.Link || now < peer.NextAttempt)
+                continue;
+            peer.NextAttempt = now + _options.PeerRetryInterval;
+
+            peer.Link = LinkNode(peer.Target);
+            if(peer.Link)
+                Log<LogLevel::Info>("Linked to node at {}.", static_cast<std::string>(peer.Target));
+        }
+    }
+
+    ClientConnection* Server::LinkNode(const Address& address)
+    {
+        std::unique_ptr<ITransport> transport = _options.DialPeer ? _options.DialPeer(address) : DialSocket(address, _options.Socket, PeerConnectTimeout);
+        if(!transport)
+            return nullptr;
+
+        Address counted = address;
+        counted.Port = 0;
+        _connectionsPerAddress[counted]++;
+
+        // Trusted from the start: no session, no rate limit, and no handshake beyond the Hello.
+        _clients.push_back(ClientConnection(std::move(transport), address));
+
+        ClientConnection& link = _clients.back();
+        link._isPeer = true;
+        link._isDialed = true;
+        link._isHandshaken = true;
+        link._lastReceived = std::chrono::steady_clock::now();
+        ScheduleConnectionTimer(link, link._lastReceived + _options.HeartbeatInterval, std::prev(_clients.end()));
+        PublishMembership();
+
+        std::ignore = link.Send(HelloMessage{ _epoch });
+        return &link;
+    }
+
+    void Server::OnHello(ClientConnection& connection, const HelloMessage& hello)
+    {
+        // A node listed as its own peer.
+        if(hello.Node == _epoch)
+        {
+            connection.Close();
+            return;
+        }
+
+        connection._isPeer = true;
+        connection._isHandshaken = true;
+        // Everything a node relays is already limited where it came in.
+        connection._rateLimiter = RateLimiter();
+        PublishMembership();
+
+        Log<LogLevel::Info>("Node {:016x} linked from {}.", hello.Node, static_cast<std::string>(connection.GetAddress()));
+    }
+
+    void Server::OnRelay(const ClientConnection& connection, const RelayMessage& relay, RoomID room)
+    {
+        // Only nodes relay, and this node's own messages never come back over a mesh that doesn't forward.
+        if(!connection._isPeer || relay.Origin == _epoch)
+            return;
+
+        uint64_t& last = _relayed[relay.Origin][room];
+        if(relay.Sequence <= last)
+            return;
+        last = relay.Sequence;
+
+        // Sequenced where the room lives. Without a ring that is every node for its own clients; with one, a relay the
+        // origin sequenced as the owner is in the history it hands over, and arriving late must not number it twice.
+        const std::span<const char> message(relay.Text.data(), relay.Text.size());
+
+        // Ordered against local broadcasts the same way they are ordered against each other.
+        std::shared_lock rooms{ _roomState };
+        Room& state = AcquireRoom(room, rooms);
+        std::unique_lock lock{ state.State };
+
+        const auto membership = _membership.Read();
+        const std::span<const ClientConnection* const> members = membership->GetMembers(room);
+
+        const MessageHeader header = relay.RoomSequence && _ring.Read()->Nodes.GetNodeCount() ?
+            MessageHeader(message.size_bytes(), MessageType::Data, room) : PushBacklog(room, state, message);
+        const SharedFrame frame = MakeFrame(header, message);
+        for(const ClientConnection* client : members)
+            client->Queue(frame, GetPriority(header.Type));
+
+        lock.unlock();
+        rooms.unlock();
+
+        for(const ClientConnection* client : members)
+            std::ignore = client->Flush(0);
+    }
+
+    void Server::Rebalance()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if(!_isRebalancing || now < _nextRebalance)
+            return;
+        _isRebalancing = false;
+
+        // Each owner gets a link and every room of its with history. The rooms stay here until it acknowledges them,
+        // so their clients are only redirected once the owner can resume them.
+        std::unordered_map<Address, ClientConnection*> links;
+        std::vector<RoomID> stranded;
+        const auto ring = _ring.Read();
+
+        // Copied one room at a time, the dialing and sending happen with no lock held.
+        std::vector<std::pair<RoomID, std::vector<BacklogEntry>>> moving;
+        {
+            std::shared_lock rooms{ _roomState };
+            for(const auto& [room, state] : _rooms)
+            {
+                const Address* owner = ring->Nodes.GetOwner(room);
+                if(!owner || *owner == ring->Self || _handOvers.contains(room))
+                    continue;
+
+                // Rooms this node only ever broadcast to without owning them have nothing to hand over.
+                std::scoped_lock lock{ state->State };
+                if(std::vector<BacklogEntry> entries = state->Backlog.GetEntries(); !entries.empty())
+                    moving.emplace_back(room, std::move(entries));
+            }
+        }
+
+        for(const auto& [room, entries] : moving)
+        {
+            const Address& owner = *ring->Nodes.GetOwner(room);
+
+            ClientConnection*& link = links[owner];
+            if(!link)
+                link = LinkNode(owner);
+
+            MigrateMessage migrate{ _epoch };
+            for(const BacklogEntry& entry : entries)
+            {
+                if(!migrate.FirstSequence)
+                    migrate.FirstSequence = entry.Sequence;
+                migrate.Messages.emplace_back(entry.Bytes.get(), entry.Size);
+            }
+
+            if(!link || !link->Send(migrate, room))
+            {
+                Log<LogLevel::Warning>("Failed to hand room {} over to {}.", room, static_cast<std::string>(owner));
+                stranded.push_back(room);
+                continue;
+            }
+
+            _handOvers[room] = link;
+        }
+
+        // Rooms without history have nothing to wait for.
+        for(const ClientConnection& client : _clients)
+        {
+            if(client._isPeer || client._rooms.empty())
+                continue;
+
+            const RoomID room = client._rooms.front();
+            if(!ring->IsOwner(room) && !_handOvers.contains(room) && !std::ranges::contains(stranded, room))
+                std::ignore = client.Send(ToRedirect(*ring->Nodes.GetOwner(room)));
+        }
+
+        if(!stranded.empty())
+        {
+            _isRebalancing = true;
+            _nextRebalance = now + _options.PeerRetryInterval;
+        }
+    }
+
+    void Server::OnMigrate(ClientConnection& connection, const MigrateMessage& migrate, RoomID room)
+    {
+        if(!connection._isPeer)
+            return;
+
+        // Empty, the owner acknowledging a room this node handed over.
+        if(!migrate.FirstSequence)
+            return OnHandedOver(room);
+
+        std::shared_lock rooms{ _roomState };
+        Room& state = AcquireRoom(room, rooms);
+        std::unique_lock lock{ state.State };
+
+        // Anything this node sequenced while the room was on its way goes after the handed over history.
+        MessageBacklog& backlog = state.Backlog;
+        const std::vector<BacklogEntry> meanwhile = backlog.GetEntries();
+
+        backlog.Rebase(migrate.FirstSequence - 1);
+        if(_store)
+            _store->LogRebase(room, migrate.FirstSequence - 1);
+
+        for(const std::string_view text : migrate.Messages)
+        {
+            backlog.Push(std::span<const char>(text.data(), text.size()));
+            if(_store)
+                _store->LogPush(room, std::span<const char>(text.data(), text.size()));
+        }
+        for(const BacklogEntry& entry : meanwhile)
+        {
+            backlog.Push(entry.GetData());
+            if(_store)
+                _store->LogPush(room, entry.GetData());
+        }
+
+        const uint64_t sequence = backlog.GetSequence();
+        lock.unlock();
+        rooms.unlock();
+
+        _importedEpochs[room] = migrate.Origin;
+        std::ignore = connection.Send(MigrateMessage{ _epoch }, room);
+
+        Log<LogLevel::Info>("Took room {} over from node {:016x} at sequence {}.", room, migrate.Origin, sequence);
+    }
+
+    void Server::OnHandedOver(RoomID room)
+    {
+        const auto handOver = _handOvers.find(room);
+        if(handOver == _handOvers.end())
+            return;
+
+        ClientConnection* link = handOver->second;
+        _handOvers.erase(handOver);
+
+        {
+            std::scoped_lock lock{ _roomState };
+            _rooms.erase(room);
+            if(_store)
+                _store->LogDrop(room);
+        }
+        _importedEpochs.erase(room);
+
+        const auto ring = _ring.Read();
+        const Address* owner = ring->Nodes.GetOwner(room);
+        Log<LogLevel::Info>("Handed room {} over to {}.", room, static_cast<std::string>(*owner));
+
+        for(const ClientConnection& client : _clients)
+            if(!client._isPeer && !client._rooms.empty() && client._rooms.front() == room)
+                std::ignore = client.Send(ToRedirect(*owner));
+
+        // The link was only for the handover.
+        if(!std::ranges::contains(_handOvers | std::views::values, link))
+            link->Close();
+    }
+
+    void Server::ScheduleConnectionTimer(ClientConnection& client, std::chrono::steady_clock::time_point time, ClientIterator iterator)
+    {
+        // Rounded up, a deadline may fire a tick late but never early.
+        client._timer = _timers.Schedule(ToTick(time, TimerResolution) + 1, iterator);
+    }
+
+    void Server::OnConnectionTimer(ClientIterator iterator)
+    {
+        ClientConnection& client = *iterator;
+
+        const auto now = std::chrono::steady_clock::now();
+        const auto idle = now - client._lastReceived;
+
+        if(!client._isHandshaken || idle >= _options.IdleTimeout)
+            return Disconnect(iterator);
+
+        if(idle >= _options.HeartbeatInterval && !client._isPingPending)
+        {
+            client._isPingPending = true;
+            std::ignore = client.Send(PingMessage{ static_cast<uint64_t>(now.time_since_epoch().count()) });
+        }
+
+        // Whatever arrived since, counts from the last frame rather than from now.
+        ScheduleConnectionTimer(client, client._lastReceived + (client._isPingPending ? _options.IdleTimeout : _options.HeartbeatInterval), iterator);
+    }
+
+    bool Server::IsQuarantined(Address address)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        address.Port = 0;
+
+        std::erase_if(_quarantine, [now](const auto& entry) { return entry.second <= now; });
+
+        return std::ranges::contains(_quarantine, address, &decltype(_quarantine)::value_type::first);
+    }
+
+    void Server::GetConnections()
+    {
+        // Rejected connections use up the budget too, turning them away is most of the work in a storm.
+        uint32_t budget = _options.MaxAcceptsPerPoll ? _options.MaxAcceptsPerPoll : UINT32_MAX;
+
+        while(budget)
+        {
+            ClientConnection connection;
+            {
+                std::scoped_lock lock{ _adoptedState };
+                if(_adopted.empty())
+                    break;
+
+                connection = std::move(_adopted.front());
+                _adopted.pop_front();
+            }
+
+            budget--;
+            if(Admit(connection.GetAddress(), _options.MaxConnectionsPerAddress))
+                AddClient(std::move(connection));
+        }
+
+        for(; budget && IConnection::IsOpen(); budget--)
+        {
+            Address address;
+            const SOCKET socket = Accept(address);
+            if(socket == InvalidSocket)
+                break;
+
+            if(!Admit(address, _options.MaxConnectionsPerAddress))
+            {
+                Log<LogLevel::Debug>("Refused connection from {}.", static_cast<std::string>(address));
+                closesocket(socket);
+                continue;
+            }
+
+            // Left non-blocking like the listening socket, GetMessages puts frames together as their bytes arrive.
+            // The closest Windows has to SOCK_CLOEXEC.
+            SetHandleInformation(reinterpret_cast<HANDLE>(socket), HANDLE_FLAG_INHERIT, 0);
+            ApplySocketOptions(socket, _options.Socket);
+
+            AddClient(ClientConnection(socket, address));
+        }
+
+        for(const auto& [listener, options] : _listeners)
+        {
+            for(; budget; budget--)
+            {
+                Address address;
+                std::unique_ptr<ITransport> transport = listener->Accept(address);
+                if(!transport)
+                    break;
+
+                if(!Admit(address, options->MaxConnectionsPerAddress))
+                {
+                    Log<LogLevel::Debug>("Refused connection from {}.", static_cast<std::string>(address));
+                    continue;
+                }
+
+                ClientConnection connection(std::move(transport), address);
+                connection._listener = options;
+                AddClient(std::move(connection));
+            }
+        }
+    }
+
+    void Server::GetMessages()
+    {
+        MessageHeader header;
+        std::vector<char> socketBuffer;
+
+        for(auto client = _clients.begin(); client != _clients.end();)
+        {
+            const auto now = std::chrono::steady_clock::now();
+
+            // Leaving it unread lets TCP flow control push back on the sender. Closed ones are reaped right away.
+            if(client->IsOpen() && (client->_rateLimiter.IsThrottled(now) || !client->IsReadable()))
+            {
+                ++client;
+                continue;
+            }
+
+            bool isReceived = false;
+            const RateLimitOptions& rateLimit = GetRateLimit(*client);
+            const size_t maxFrameSize = client->_isPeer ? 0 : rateLimit.MaxFrameSize;
+            if(!client->IsOpen() || !client->TryReceive(header, socketBuffer, isReceived, maxFrameSize))
+            {
+                Disconnect(client++);
+                continue;
+            }
+
+            // Part of a frame, the rest comes on a later poll.
+            if(!isReceived)
+            {
+                ++client;
+                continue;
+            }
+
+            client->_lastReceived = now;
+            client->_isPingPending = false;
+
+            const RateLimitAction action = client->_rateLimiter.OnFrame(rateLimit, sizeof(header) + header.Size, now);
+            if(action == RateLimitAction::Disconnect)
+            {
+                Address quarantined = client->GetAddress();
+                quarantined.Port = 0;
+                _quarantine.emplace_back(quarantined, now + rateLimit.QuarantineTime);
+
+                Disconnect(client++);
+                continue;
+            }
+
+            // Control frames still go through, the peer would just get reaped otherwise.
+            if(action == RateLimitAction::Drop && header.Type == MessageType::Data)
+            {
+                ++client;
+                continue;
+            }
+
+            // Nodes only relay. Anything a node sends as a client would be taken for one of this node's clients.
+            if(client->_isPeer && header.Type == MessageType::Data)
+            {
+                ++client;
+                continue;
+            }
+
+            Handlers_.Dispatch(*client, header, socketBuffer);
+
+            ++client;
+        }
+    }
+
+    void Server::Listen()
+    {
+        _thread = std::thread([this]()
+        {
+            {
+                std::unique_lock l{_state};
                 _shouldClose = false;
             }
 
             volatile bool close;
             do
             {
-                std::unique_lock l{_state};
-
-                close = _shouldClose;
+                {
+                    std::unique_lock l{_state};
+                    close = _shouldClose;
+                }
 
-                GetConnections();
-                GetMessages();
+                Poll();
             } while(!close);
         });
         _thread.detach();
     }
 
+    void Server::Poll()
+    {
+        std::unique_lock l{_state};
+
+        // Nothing of this server's is left to run once the successor has it.
+        if(_restartListener && HandOff())
+            return;
+
+        GetConnections();
+        ConnectPeers();
+        Rebalance();
+        GetMessages();
+        JoinRooms();
+
+        for(auto client = _clients.begin(); client != _clients.end();)
+        {
+            std::ignore = client->Flush(_options.BulkBytesPerPoll);
+
+            // Stopped reading, or can't keep up. Either way it would hold on to everything sent to it.
+            if(const size_t queued = client->GetQueuedBytes(); _options.MaxQueuedBytes && queued > _options.MaxQueuedBytes)
+            {
+                Log<LogLevel::Warning>("Disconnecting {}, {} bytes queued for it.", static_cast<std::string>(client->GetAddress()), queued);
+                Disconnect(client++);
+                continue;
+            }
+
+            ++client;
+        }
+
+        if(_store)
+        {
+            if(!_store->IsWriting() && _store->GetLogSize() >= _options.SnapshotLogBytes)
+                SnapshotStore();
+            // Everything broadcasts logged since the last pass, in one write.
+            _store->Flush();
+        }
+
+        _timers.Advance(ToTick(std::chrono::steady_clock::now(), TimerResolution), [this](ClientIterator client)
+        {
+            OnConnectionTimer(client);
+        });
+
+        // Leaves are published once per pass, however many there were.
+        if(!_leaving.empty())
+            PublishMembership();
+        _membership.Reclaim();
+        _ring.Reclaim();
+    }
+
     void Server::Join()
     {
         {
@@ -382,7 +1920,20 @@ namespace Secretest
     {
         Join();
 
-        _clients.clear();
+        _leaving.splice(_leaving.end(), _clients);
+        PublishMembership();
+        _listeners.clear();
+        _restartListener.reset();
+        for(PeerNode& peer : _peerNodes)
+            peer.Link = nullptr;
+        _handOvers.clear();
+        {
+            // Broadcasts from other threads may still be logging.
+            std::scoped_lock lock{ _roomState };
+            _store.reset();
+        }
+        _connectionsPerAddress.clear();
+        _timers = TimerWheel<ClientIterator>(ToTick(std::chrono::steady_clock::now(), TimerResolution));
 
         IConnection::Close();
     }
@@ -4,11 +4,33 @@
 
 #pragma once
 
+#include "Backlog.h"
+#include "HashRing.h"
+#include "Outbound.h"
+#include "Protocol.h"
+#include "RateLimiter.h"
+#include "StateStore.h"
+#include "Transport.h"
+
+#include <Secretest/Utility/Log.h>
+#include <Secretest/Utility/RcuPointer.h>
+#include <Secretest/Utility/TimerWheel.h>
+
+#include <array>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
-#include <print>
+#include <deque>
+#include <format>
+#include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 struct addrinfo;
@@ -28,27 +50,136 @@ namespace Secretest
         ~SocketContext();
     };
 
+    enum class AddressFamily : uint8_t
+    {
+        IPv4,
+        IPv6,
+        // A process on this machine, reached through a listener rather than the network. Never dialed.
+        Process
+    };
+
     struct Address
     {
         Address(uint32_t ip, uint16_t port) : IP(ip), Port(port) {};
         Address(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint16_t port) : IPBytes{ a, b, c, d }, Port(port) {};
+        Address(const std::array<uint8_t, 16>& ip, uint16_t port) : Family(AddressFamily::IPv6), IPv6Bytes(ip), Port(port) {};
         Address() = default;
 
-        explicit operator std::string()
+        // Every address the host resolves to, in resolver preference order. Empty if resolution fails.
+        static std::vector<Address> Resolve(std::string_view host, uint16_t port);
+        // Identifies a local peer by its process ID, so each process is counted and quarantined on its own.
+        static Address FromProcess(uint32_t processID)
+        {
+            Address address(processID, 0);
+            address.Family = AddressFamily::Process;
+            return address;
+        }
+
+        explicit operator std::string() const
         {
-            return std::format("{}.{}.{}.{}:{}", IPBytes[3], IPBytes[2], IPBytes[1], IPBytes[0], Port);
+            if(Family == AddressFamily::IPv4)
+                return std::format("{}.{}.{}.{}:{}", IPBytes[0], IPBytes[1], IPBytes[2], IPBytes[3], Port);
+            if(Family == AddressFamily::Process)
+                return std::format("process {}", IP);
+
+            std::string result = "[";
+            for(size_t i = 0; i < IPv6Bytes.size(); i += 2)
+                result += std::format("{}{:x}", i ? ":" : "", IPv6Bytes[i] << 8 | IPv6Bytes[i + 1]);
+            return result + std::format("]:{}", Port);
         }
 
+        AddressFamily Family = AddressFamily::IPv4;
+
         union
         {
             uint32_t IP;
             uint8_t IPBytes[4];
+            std::array<uint8_t, 16> IPv6Bytes;
         };
 
         uint16_t Port;
 
 
-        bool operator==(const Address& b) const { return Port == b.Port && IP == b.IP; }
+        bool operator==(const Address& b) const
+        {
+            if(Family != b.Family || Port != b.Port)
+                return false;
+            return Family == AddressFamily::IPv6 ? IPv6Bytes == b.IPv6Bytes : IP == b.IP;
+        }
+    };
+}
+
+template<>
+struct std::hash<Secretest::Address>
+{
+    size_t operator()(const Secretest::Address& address) const noexcept
+    {
+        uint64_t result = static_cast<uint64_t>(address.Port) << 8 | static_cast<uint64_t>(address.Family);
+
+        if(address.Family != Secretest::AddressFamily::IPv6)
+            return std::hash<uint64_t>{}(result ^ static_cast<uint64_t>(address.IP) << 24);
+
+        // FNV-1a style over the two halves.
+        for(size_t i = 0; i < address.IPv6Bytes.size(); i += sizeof(uint64_t))
+        {
+            uint64_t half;
+            std::memcpy(&half, address.IPv6Bytes.data() + i, sizeof(half));
+            result = (result ^ half) * 0x100000001B3;
+        }
+
+        return std::hash<uint64_t>{}(result);
+    }
+};
+
+namespace Secretest
+{
+    // Applied to every socket a Server or Client creates or accepts. Options the platform doesn't have are skipped.
+    struct SocketOptions
+    {
+        // Nagle off, small frames go out at once.
+        bool NoDelay = true;
+        // ACK every segment instead of delaying. Linux TCP_QUICKACK, Windows ACK frequency 1.
+        bool QuickAck = false;
+
+        // Zero keeps the system default.
+        int32_t SendBufferSize = 0;
+        int32_t ReceiveBufferSize = 0;
+
+        // Linux only, spins on the device queue instead of sleeping in a blocking read. Costs a core.
+        std::chrono::microseconds BusyPoll{ 0 };
+
+        // Zero disables keepalive probes.
+        std::chrono::milliseconds KeepAliveIdle{ 0 };
+        std::chrono::milliseconds KeepAliveInterval{ 1000 };
+
+        // Linux only, caps unsent data in the kernel so queued frames wait in the outbound lanes where they can be reordered.
+        // Zero keeps the system default.
+        uint32_t NotSentLowWatermark = 0;
+
+        // Whatever the system does.
+        static SocketOptions System() { return { .NoDelay = false }; }
+        // Chat: every frame out immediately, dead peers found within seconds.
+        static SocketOptions Interactive()
+        {
+            return {
+                .NoDelay = true,
+                .QuickAck = true,
+                .KeepAliveIdle = std::chrono::seconds(10),
+                .KeepAliveInterval = std::chrono::seconds(1),
+                .NotSentLowWatermark = 16 * 1024
+            };
+        }
+        // Throughput: Nagle on, large buffers.
+        static SocketOptions Bulk()
+        {
+            return {
+                .NoDelay = false,
+                .SendBufferSize = 1024 * 1024,
+                .ReceiveBufferSize = 1024 * 1024,
+                .KeepAliveIdle = std::chrono::seconds(60),
+                .KeepAliveInterval = std::chrono::seconds(5)
+            };
+        }
     };
 
     enum class IConnectionStatusQueryType
@@ -69,7 +200,7 @@ namespace Secretest
     class IConnection
     {
     public:
-        explicit IConnection(Address address);
+        explicit IConnection(Address address, const SocketOptions& options = {});
 
         IConnection() = default;
         IConnection(const IConnection&) = delete;
@@ -79,7 +210,7 @@ namespace Secretest
 
         [[nodiscard]] Address GetAddress() const { return Address_; }
         [[nodiscard]] int32_t GetStatus(IConnectionStatusQueryType type) const;
-        [[nodiscard]] bool IsOpen() const { return Socket_ != InvalidSocket; }
+        [[nodiscard]] virtual bool IsOpen() const { return Socket_ != InvalidSocket; }
 
         virtual void Close();
 
@@ -90,6 +221,37 @@ namespace Secretest
         Address Address_ = {};
     };
 
+    // Owns its socket.
+    class SocketTransport final : public ITransport
+    {
+    public:
+        explicit SocketTransport(SOCKET socket) : _socket(socket) {}
+        SocketTransport(const SocketTransport&) = delete;
+        SocketTransport& operator=(const SocketTransport&) = delete;
+
+        bool Read(std::span<char> buf) override;
+        bool ReadSome(std::span<char> buf, size_t& read) override;
+        bool Write(std::span<const std::span<const char>> parts) override;
+        bool WriteSome(std::span<const char> buf, size_t& written) override;
+
+        [[nodiscard]] bool IsReadable() const override;
+        [[nodiscard]] bool WaitReadable(std::chrono::milliseconds timeout) const override;
+        [[nodiscard]] bool IsWritable() const override;
+        [[nodiscard]] bool IsOpen() const override { return _socket != InvalidSocket; }
+        [[nodiscard]] SOCKET GetSocket() const { return _socket; }
+
+        void Close() override;
+
+        ~SocketTransport() override { SocketTransport::Close(); }
+
+    private:
+        // Blocks until the socket is readable or writable, false if the timeout passes first; the default never does.
+        // Lets Read and Write block on a non-blocking socket.
+        bool Wait(bool isWrite, std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) const;
+
+        SOCKET _socket;
+    };
+
     class IOConnection : public IConnection
     {
     public:
@@ -97,34 +259,96 @@ namespace Secretest
         IOConnection(IOConnection&& b) noexcept = default;
         IOConnection& operator=(IOConnection&& b) noexcept = default;
 
-        explicit IOConnection(Address address) : IConnection(address) {};
+        explicit IOConnection(std::unique_ptr<ITransport> transport, Address address = {}) : Transport_(std::move(transport)) { Address_ = address; }
 
-        bool Receive(std::vector<char>& buf) const;
-        bool Send(std::span<const char> buf) const;
-    };
+        [[nodiscard]] bool IsOpen() const override { return Transport_ && Transport_->IsOpen(); }
+        [[nodiscard]] bool IsReadable() const { return Transport_ && Transport_->IsReadable(); }
 
-    struct MessageHeader
-    {
-        MessageHeader() = default;
-        explicit MessageHeader(size_t size) : SizeChecksum(CalculateChecksum(size)), Size(size) {};
+        void Close() override;
 
-        [[nodiscard]] bool IsValid() const
+        bool Receive(MessageHeader& header, std::vector<char>& buf) const;
+        // Same, but false once the timeout passes without a whole frame.
+        bool Receive(MessageHeader& header, std::vector<char>& buf, std::chrono::milliseconds timeout);
+        // Never blocks. Reads what has arrived and sets isReceived once it completes a frame, keeping the part of one
+        // that hasn't. False once the stream is closed or broken, or the header is invalid or over maxSize, zero
+        // being unlimited.
+        bool TryReceive(MessageHeader& header, std::vector<char>& buf, bool& isReceived, size_t maxSize);
+
+        // Queued in the frame's lane, then everything urgent is flushed. Bulk frames wait for Flush.
+        // Thread safe; if another thread is mid-flush, it sends the frame instead.
+        bool Send(const MessageHeader& header, std::span<const char> buf) const { return Send(header, buf, GetPriority(header.Type)); }
+        bool Send(const MessageHeader& header, std::span<const char> buf, MessagePriority priority) const;
+        bool Send(std::span<const char> buf) const { return Send(MessageHeader(buf.size_bytes()), buf); }
+
+        // Queued only, nothing goes out before the next Send or Flush. For putting frames in order under a lock and
+        // writing them after it.
+        void Queue(const MessageHeader& header, std::span<const char> buf) const { Queue(header, buf, GetPriority(header.Type)); }
+        void Queue(const MessageHeader& header, std::span<const char> buf, MessagePriority priority) const { Queue(MakeFrame(header, buf), priority); }
+        void Queue(SharedFrame frame, MessagePriority priority) const;
+
+        // Writes queued frames while the transport takes them without waiting, up to bulkBudget bytes of bulk ones.
+        // Whatever doesn't go, part of a frame included, waits for the next Send or Flush.
+        bool Flush(size_t bulkBudget) const;
+
+        // Queued and not written yet, part of a frame included.
+        [[nodiscard]] size_t GetQueuedBytes() const;
+
+        using QueuedFrame = std::pair<MessagePriority, SharedFrame>;
+
+        // Everything still queued with its lane, in the order it would have gone out, leaving out a frame that is
+        // part way written. For handing the connection on.
+        std::vector<QueuedFrame> TakeQueued() const;
+        // Queued again, nothing is sent until the next Send or Flush.
+        void Requeue(std::span<const QueuedFrame> frames) const;
+
+        // The rest of the frame Flush is part way through, it goes out before anything queued. For handing the
+        // connection on.
+        [[nodiscard]] std::vector<char> GetUnsent() const;
+        // Carries on from a handed connection's partly written frame.
+        void SetUnsent(std::vector<char> unsent) const;
+
+        // The part of a frame TryReceive has read so far. For handing the connection on.
+        [[nodiscard]] std::span<const char> GetInbound() const { return _inbound; }
+        // Carries on from a handed connection's partial frame.
+        void SetInbound(std::vector<char> inbound) { _inbound = std::move(inbound); }
+
+        template<IsMessage T>
+        bool Send(const T& message, RoomID room = DefaultRoom) const
         {
-            return SizeChecksum == CalculateChecksum(Size) &&
-                   Size > 0 &&
-                   Magic == MagicValue;
+            // Serializers view the message where they can and return their own buffer where they can't.
+            const auto& serialized = MessageSerializer<T>::Serialize(message);
+            const std::span<const char> payload(serialized);
+            return Send(MessageHeader(payload.size_bytes(), T::Type, room), payload);
         }
 
-        std::array<char, 3> Magic = MagicValue;
-        uint8_t SizeChecksum = UINT8_MAX;
-        size_t Size = SIZE_MAX;
+    protected:
+        std::unique_ptr<ITransport> Transport_;
 
     private:
-        static constexpr uint8_t CalculateChecksum(size_t size) { return size % UINT8_MAX; }
-        static constexpr std::array<char, 3> MagicValue { 'S', 'C', 'K' };
+        struct Outbound
+        {
+            std::mutex State;
+            OutboundQueue Queue;
+            bool IsFlushing = false;
+
+            // Popped from the queue, the transport has taken Written bytes of it so far.
+            SharedFrame Writing;
+            size_t Written = 0;
+        };
+
+        // Behind a pointer to stay movable.
+        std::unique_ptr<Outbound> _outbound = std::make_unique<Outbound>();
+        // The frame TryReceive is part way through, header first.
+        std::vector<char> _inbound;
     };
 
-    class InvalidHeaderException final : public std::exception {};
+    // For connections a listener takes, in place of the server's limits for network clients.
+    struct ListenerOptions
+    {
+        RateLimitOptions RateLimit = RateLimitOptions::Local();
+        // Per identity the listener reports, e.g. per peer process. Zero is unlimited.
+        uint32_t MaxConnectionsPerAddress = 64;
+    };
 
     // Server to client connection
     class ClientConnection final : public IOConnection
@@ -134,10 +358,67 @@ namespace Secretest
         ClientConnection(ClientConnection&& b) noexcept = default;
         ClientConnection& operator=(ClientConnection&& b) noexcept = default;
 
+        // A link to another node rather than a client.
+        [[nodiscard]] bool IsPeer() const { return _isPeer; }
+
         friend class Server;
 
     private:
-        explicit ClientConnection(SOCKET socket);
+        ClientConnection(SOCKET socket, Address address);
+        ClientConnection(std::unique_ptr<ITransport> transport, Address address) : IOConnection(std::move(transport), address) {}
+
+        // Liveness, driven by the server's timer wheel.
+        std::chrono::steady_clock::time_point _lastReceived = std::chrono::steady_clock::now();
+        TimerHandle _timer;
+        bool _isHandshaken = false;
+        bool _isPingPending = false;
+        bool _isPeer = false;
+        // By this node, for federation or a handover. Never announced to OnConnect.
+        bool _isDialed = false;
+        // Rooms it resumed, the first one decides which node it belongs on.
+        std::vector<RoomID> _rooms;
+
+        RateLimiter _rateLimiter;
+        // Set when taken through a listener, whose limits then apply instead of the server's.
+        std::shared_ptr<const ListenerOptions> _listener;
+    };
+
+    struct ServerOptions
+    {
+        // A client that hasn't sent its Resume by then is dropped.
+        std::chrono::milliseconds HandshakeTimeout = std::chrono::seconds(5);
+        // A client quiet for this long is pinged.
+        std::chrono::milliseconds HeartbeatInterval = std::chrono::seconds(10);
+        // A client quiet for this long is dropped, pinged or not.
+        std::chrono::milliseconds IdleTimeout = std::chrono::seconds(30);
+
+        // Per connection, applied before anything is dispatched or rebroadcast.
+        RateLimitOptions RateLimit;
+
+        // Admission control, checked right after accept and before anything is allocated for the connection.
+        // Zero is unlimited. The per address limit ignores the port.
+        uint32_t MaxConnections = 4096;
+        uint32_t MaxConnectionsPerAddress = 64;
+        // Connections taken per pass of the listening loop, so a reconnect storm can't starve established clients.
+        uint32_t MaxAcceptsPerPoll = 64;
+
+        // Per connection and pass of the listening loop, how much history replay may be written.
+        size_t BulkBytesPerPoll = 64 * 1024;
+        // A connection with more than this queued is disconnected. Zero is unlimited. Replay counts too, so it has to
+        // leave room for a room's history.
+        size_t MaxQueuedBytes = 16 * 1024 * 1024;
+
+        // Applied to the listening socket and again to every accepted one.
+        SocketOptions Socket = SocketOptions::Interactive();
+
+        // Persistence: a snapshot is started once the log of changes since the last one has grown this much, which
+        // bounds how much a restart replays.
+        uint64_t SnapshotLogBytes = 16 * 1024 * 1024;
+
+        // Federation: a dropped link to a peer node is dialed again after this long.
+        std::chrono::milliseconds PeerRetryInterval = std::chrono::seconds(1);
+        // Replaces TCP for links to peer nodes when set, e.g. with SimulatedNetwork::GetDialer.
+        std::function<std::unique_ptr<ITransport>(const Address&)> DialPeer;
     };
 
     class ServerCreationException : public std::exception
@@ -154,46 +435,250 @@ namespace Secretest
     class Server : public IConnection
     {
     public:
-        explicit Server(uint16_t port);
+        explicit Server(uint16_t port, ServerOptions options = {});
+        // An IPv6 address also accepts IPv4 clients.
+        explicit Server(Address address, ServerOptions options = {});
+        // No socket, connections only come in through Adopt and listeners.
+        explicit Server(ServerOptions options);
+
+        // Thread safe. Picked up with the next batch of accepted sockets.
+        void Adopt(std::unique_ptr<ITransport> transport, Address address);
+        // Polled next to the listening socket, within the same accept budget. What it accepts is admitted and rate
+        // limited by the options instead of the server's, MaxConnections aside.
+        void AddListener(std::unique_ptr<IListener> listener, ListenerOptions options = {});
+
+        // Federation. Links to the node listening there and redials it whenever the link drops. Nodes form a full mesh
+        // with one link per pair, dialed from either end; each relays its own clients' messages and nothing else.
+        void AddPeer(Address address);
+        // Random per start, so a restarted node never looks like it is repeating itself. Kept across a hot restart.
+        [[nodiscard]] uint64_t GetNodeID() const { return _epoch; }
+
+        // Hot restart. A successor calling TakeOver on the path gets the listening socket, every socket connection with
+        // what was queued for it, and the rooms; this server then stops without anyone noticing. Connections over
+        // other transports are closed and reconnect. Only processes of the same user are served.
+        // Throws ServerCreationException.
+        void EnableHotRestart(std::string path);
+        // Before Listen, on a server built without a socket. False if nothing answers on the path or the handoff
+        // fails, in which case the predecessor carries on.
+        bool TakeOver(std::string_view path);
+        [[nodiscard]] bool IsHandedOff() const { return _isHandedOff; }
+
+        // Persistence. Restores the rooms kept at the path, unless the server already has some from TakeOver, then
+        // logs every change to them there and snapshots them in the background. Clients resume across a cold restart
+        // as if the rooms had been handed over from another node. Before Listen.
+        // Throws ServerCreationException.
+        void EnablePersistence(std::string path);
+
+        // Room placement. Every node gets the same ring and its own entry in it. Rooms owned elsewhere have their
+        // history handed to the owner and their clients redirected there; a new ring rebalances the same way.
+        void SetRing(HashRing<Address> ring, Address self);
 
         void Listen();
+        // One pass of the listening loop, for driving the server without its thread.
+        void Poll();
         void Join();
         void Close() override;
 
+        // Changed by the listening thread without a lock, only read it from there or once the server is joined.
         const std::list<ClientConnection>& GetClients() const { return _clients; }
 
         ~Server() override;
 
     protected:
-        [[nodiscard]] ClientConnection Accept(Address address = {}) const;
-
         virtual void OnConnect(ClientConnection& connection);
         virtual void OnDisconnect(Address address);
-        virtual void OnMessage(ClientConnection& connection, std::span<const char> message);
 
-        void SendToClients(std::span<const char> message) const;
-        void SendToClientsExcept(std::span<const char>, std::span<Address> except) const;
-        void SendToClientsExcept(std::span<const char>, std::span<ClientConnection*> except) const;
+        // To the default room's members. Sequenced into its backlog on the node owning it so reconnecting clients can
+        // resume, and relayed to every peer node. Thread safe, concurrent broadcasts only share the brief step of
+        // putting frames in order, the writes themselves happen in parallel.
+        void SendToClients(std::span<const char> message);
+        void SendToClientsExcept(std::span<const char>, std::span<Address> except);
+        void SendToClientsExcept(std::span<const char>, std::span<ClientConnection*> except);
+
+        // Control messages are registered by the server itself, replacing them breaks the protocol.
+        MessageDispatcher<ProtocolSchema, ClientConnection&> Handlers_;
 
     private:
         void GetConnections();
         void GetMessages();
 
+        // InvalidSocket once the backlog is empty; the listening socket doesn't block.
+        [[nodiscard]] SOCKET Accept(Address& address) const;
+        [[nodiscard]] bool Admit(Address address, uint32_t maxConnectionsPerAddress);
+        [[nodiscard]] const RateLimitOptions& GetRateLimit(const ClientConnection& client) const;
+        void AddClient(ClientConnection&& connection);
+
+        struct Room;
+
+        // Shared under rooms. One without history yet is added, which takes _roomState exclusively for a moment.
+        Room& AcquireRoom(RoomID room, std::shared_lock<std::shared_mutex>& rooms);
+        // Under the room's lock.
+        MessageHeader PushBacklog(RoomID room, Room& state, std::span<const char> message);
+        // Under _roomState exclusively. Shares the messages, only the handles are copied.
+        [[nodiscard]] std::vector<RoomSnapshot> SnapshotRooms() const;
+        // Under _roomState exclusively. Replaces every room.
+        void RestoreRooms(std::unordered_map<RoomID, MessageBacklog> rooms);
+        // Copies each room for the store under its own lock, broadcasts to the others carry on.
+        void SnapshotStore();
+        // Under the room's lock, along with the client joining the room, so live frames pick up right where the replay ends.
+        void OnResume(const ClientConnection& connection, ResumeMessage resume, const MessageBacklog& backlog);
+
+        void RegisterHandlers();
+
+        // To every local client isExcepted doesn't match, and once to every peer node. From any thread.
+        template<typename EXCEPT_T>
+        void Broadcast(RoomID room, std::span<const char> message, EXCEPT_T isExcepted);
+
+        void ConnectPeers();
+        void OnHello(ClientConnection& connection, const HelloMessage& hello);
+        void OnRelay(const ClientConnection& connection, const RelayMessage& relay, RoomID room);
+        // Dialed, already in the client list and greeted. Null if the node can't be reached.
+        ClientConnection* LinkNode(const Address& address);
+
+        void Rebalance();
+        // True once everything is the successor's.
+        bool HandOff();
+        void OnMigrate(ClientConnection& connection, const MigrateMessage& migrate, RoomID room);
+        void OnHandedOver(RoomID room);
+
+        using ClientIterator = std::list<ClientConnection>::iterator;
+
+        // Its connection stays alive until no broadcast can be writing to it anymore.
+        void Disconnect(ClientIterator client);
+        // Whenever clients join rooms or a peer links. Retires whoever left since the last one.
+        void PublishMembership();
+        // Everything resumed this pass: joined, published once and replayed.
+        void JoinRooms();
+        void OnConnectionTimer(ClientIterator client);
+        void ScheduleConnectionTimer(ClientConnection& client, std::chrono::steady_clock::time_point time, ClientIterator iterator);
+        bool IsQuarantined(Address address);
+
         std::list<ClientConnection> _clients;
+        // Disconnected, but possibly still in the published membership. Retired with the next one.
+        std::list<ClientConnection> _leaving;
+        // Resumed this pass. Kept out of the membership until JoinRooms, which replays to them in the same go.
+        std::vector<std::pair<ClientConnection*, ResumeMessage>> _joining;
+
+        // Who a broadcast goes to, rebuilt from the client list whenever rooms or peers change.
+        struct Membership
+        {
+            std::unordered_map<RoomID, std::vector<const ClientConnection*>> Rooms;
+            std::vector<const ClientConnection*> Peers;
+
+            [[nodiscard]] std::span<const ClientConnection* const> GetMembers(RoomID room) const
+            {
+                const auto members = Rooms.find(room);
+                return members == Rooms.end() ? std::span<const ClientConnection* const>() : members->second;
+            }
+        };
+
+        // Read by broadcasts on any thread without waiting, published by the listening thread.
+        RcuPointer<Membership> _membership;
+
+        std::deque<ClientConnection> _adopted;
+        std::mutex _adoptedState;
+        std::vector<std::pair<std::unique_ptr<IListener>, std::shared_ptr<const ListenerOptions>>> _listeners;
         std::mutex _state;
         std::thread _thread;
         volatile bool _shouldClose = false;
+
+        std::unique_ptr<IListener> _restartListener;
+        volatile bool _isHandedOff = false;
+
+        ServerOptions _options;
+
+        // One timer per connection, rescheduled lazily when it fires rather than on every frame.
+        static constexpr std::chrono::milliseconds TimerResolution{ 10 };
+        TimerWheel<ClientIterator> _timers;
+
+        // Port ignored, like everything admission control looks at.
+        std::unordered_map<Address, uint32_t> _connectionsPerAddress;
+
+        // Addresses disconnected for flooding, port ignored.
+        std::vector<std::pair<Address, std::chrono::steady_clock::time_point>> _quarantine;
+
+        // Changes every time a server is started, sequence numbers from another epoch are meaningless.
+        uint64_t _epoch;
+
+        // Numbered, logged and queued to its members under State, so every member gets a room's frames in order.
+        struct Room
+        {
+            std::mutex State;
+            MessageBacklog Backlog;
+            // Numbered once however many nodes a message goes to, that is what lets a node spot it arriving twice.
+            uint64_t RelaySequence = 0;
+        };
+
+        // Shared by broadcasts, which lock their room on top. Exclusive to add or drop a room, or to stop every one.
+        std::unordered_map<RoomID, std::unique_ptr<Room>> _rooms;
+        std::shared_mutex _roomState;
+        // Null unless persistent. Logged to under a room's lock, reset under _roomState exclusively.
+        std::unique_ptr<StateStore> _store;
+
+        struct PeerNode
+        {
+            Address Target;
+            // Null while the link is down.
+            const ClientConnection* Link = nullptr;
+            std::chrono::steady_clock::time_point NextAttempt;
+        };
+
+        std::vector<PeerNode> _peerNodes;
+        // Highest relay sequence seen per origin node and room. Each origin relays a room in order over an ordered link,
+        // so anything at or below it is a duplicate that came in over a second link.
+        std::unordered_map<uint64_t, std::unordered_map<RoomID, uint64_t>> _relayed;
+
+        // Which node owns which room, and which one is this.
+        struct Ring
+        {
+            HashRing<Address> Nodes;
+            Address Self;
+
+            // Only the owner sequences a room. With no ring that is every node for every room.
+            [[nodiscard]] bool IsOwner(RoomID room) const
+            {
+                const Address* owner = Nodes.GetOwner(room);
+                return !owner || *owner == Self;
+            }
+        };
+
+        // Read by broadcasts on any thread without waiting, published by SetRing under _state.
+        RcuPointer<Ring> _ring;
+        bool _isRebalancing = false;
+        std::chrono::steady_clock::time_point _nextRebalance;
+        // Rooms on their way to their owner, by the link they went over.
+        std::unordered_map<RoomID, ClientConnection*> _handOvers;
+        // Rooms handed to this node, by the node they came from. Its clients resume as if they never left.
+        std::unordered_map<RoomID, uint64_t> _importedEpochs;
+    };
+
+    struct ConnectOptions
+    {
+        // How long a single address gets before it is given up on.
+        std::chrono::milliseconds AttemptTimeout = std::chrono::seconds(2);
+        // Head start an attempt gets before the next address is raced against it (RFC 8305).
+        std::chrono::milliseconds AttemptDelay = std::chrono::milliseconds(250);
+        // Nothing from the server for this long, heartbeats included, counts as a disconnect.
+        std::chrono::milliseconds IdleTimeout = std::chrono::seconds(45);
+
+        SocketOptions Socket = SocketOptions::Interactive();
+
+        // Replaces TCP when set, e.g. with SimulatedNetwork::GetDialer. Null counts as a refused connect.
+        std::function<std::unique_ptr<ITransport>(const Address&)> Dial;
     };
 
     // Client to server connection
     class Client : public IOConnection
     {
     public:
-        explicit Client(Address address);
+        explicit Client(Address address, ConnectOptions options = {});
+        // Candidates are raced Happy Eyeballs style, alternating address families.
+        explicit Client(std::vector<Address> addresses, ConnectOptions options = {});
 
         // Better hope this returns before the object is deleted.
         // Automatically listens when connected.
-        void ConnectAsync(uint8_t retryCount, std::chrono::duration<float> retryTime = std::chrono::seconds(1));
+        // Retries back off exponentially from retryTime up to maxRetryTime, with full jitter.
+        void ConnectAsync(uint8_t retryCount, std::chrono::duration<float> retryTime = std::chrono::seconds(1), std::chrono::duration<float> maxRetryTime = std::chrono::seconds(30));
 
         bool Connect();
         void Listen();
@@ -207,18 +692,34 @@ namespace Secretest
         ~Client() override;
 
     protected:
-        virtual void OnConnect() { std::println("Connected to server."); };
-        virtual void OnDisconnect() { std::println("Disconnected from server."); };
-        virtual void OnConnectFailure() { std::println("Failed to connect to server."); };
-        virtual void OnMessage(std::span<const char> message) {};
-        virtual void OnConnectAttempt(uint8_t attempt) { std::println("Attempting to connect to server. Attempt: {}", static_cast<uint32_t>(attempt)); }
+        virtual void OnConnect() { Log<LogLevel::Info>("Connected to server."); };
+        virtual void OnDisconnect() { Log<LogLevel::Info>("Disconnected from server."); };
+        virtual void OnConnectFailure() { Log<LogLevel::Warning>("Failed to connect to server."); };
+        virtual void OnConnectAttempt(uint8_t attempt) { Log<LogLevel::Info>("Attempting to connect to server. Attempt: {}", static_cast<uint32_t>(attempt)); }
+
+        // Data frames only reach these once, replays of frames already seen are filtered out.
+        MessageDispatcher<ProtocolSchema> Handlers_;
 
     private:
         bool InternalConnect();
+        bool Dial();
+        void OnConnected(std::unique_ptr<ITransport> transport, Address address);
+        void OnSession(const SessionMessage& session);
+        void OnRedirect(const RedirectMessage& redirect);
+        void SendResume() const;
+
+        std::vector<Address> _addresses;
+        ConnectOptions _options;
 
         std::mutex _state;
         std::thread _thread;
         volatile bool _isListening = false;
         bool _isConnected = false;
+
+        // Resume token, kept across reconnects.
+        uint64_t _epoch = 0;
+        std::unordered_map<RoomID, uint64_t> _sequences;
+        // The node redirected to carries on with the old node's sequences.
+        bool _isRedirected = false;
     };
 }
@@ -0,0 +1,90 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace Secretest
+{
+    // Server state as bytes, for handing it to a successor or putting it on disk. Only ever read back by the same
+    // build, values go in as they are laid out in memory.
+    class StateWriter
+    {
+    public:
+        template<typename T> requires std::is_trivially_copyable_v<T>
+        void Write(const T& value)
+        {
+            const char* bytes = reinterpret_cast<const char*>(&value);
+            _buffer.insert(_buffer.end(), bytes, bytes + sizeof(T));
+        }
+
+        void WriteBytes(std::span<const char> bytes)
+        {
+            Write<uint64_t>(bytes.size());
+            _buffer.insert(_buffer.end(), bytes.begin(), bytes.end());
+        }
+
+        // Over what was written there before, for sizes only known at the end.
+        template<typename T> requires std::is_trivially_copyable_v<T>
+        void WriteAt(size_t offset, const T& value)
+        {
+            std::memcpy(_buffer.data() + offset, &value, sizeof(T));
+        }
+
+        [[nodiscard]] std::span<const char> Get() const { return _buffer; }
+        [[nodiscard]] size_t GetSize() const { return _buffer.size(); }
+        void Clear() { _buffer.clear(); }
+
+    private:
+        std::vector<char> _buffer;
+    };
+
+    // Reads past the end come back zeroed and invalidate the reader.
+    class StateReader
+    {
+    public:
+        explicit StateReader(std::span<const char> buffer) : _buffer(buffer) {}
+
+        template<typename T> requires std::is_trivially_copyable_v<T>
+        T Read()
+        {
+            T value{};
+            if(_buffer.size() < sizeof(T))
+            {
+                _isValid = false;
+                return value;
+            }
+
+            std::memcpy(&value, _buffer.data(), sizeof(T));
+            _buffer = _buffer.subspan(sizeof(T));
+            return value;
+        }
+
+        std::span<const char> ReadBytes()
+        {
+            const uint64_t size = Read<uint64_t>();
+            if(!_isValid || _buffer.size() < size)
+            {
+                _isValid = false;
+                return {};
+            }
+
+            const std::span<const char> bytes = _buffer.first(size);
+            _buffer = _buffer.subspan(size);
+            return bytes;
+        }
+
+        [[nodiscard]] bool IsValid() const { return _isValid; }
+        [[nodiscard]] bool IsEmpty() const { return _buffer.empty(); }
+
+    private:
+        std::span<const char> _buffer;
+        bool _isValid = true;
+    };
+}
@@ -0,0 +1,396 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#include "StateStore.h"
+
+#include <Secretest/Utility/Log.h>
+
+#include <algorithm>
+#include <format>
+#include <windows.h>
+
+// A log starts with its magic and the epoch of the process writing it, then holds one record per change, each prefixed
+// with its size so one the process died writing is recognised and dropped. A snapshot holds the generation of the
+// first log to replay after it, the epoch, and the rooms.
+
+namespace Secretest
+{
+    namespace
+    {
+        constexpr uint32_t SnapshotMagic = 0x50534E53;
+        constexpr uint32_t LogMagic = 0x474F4C53;
+
+        enum class Change : uint8_t
+        {
+            Push,
+            Rebase,
+            Drop
+        };
+
+        // Read only. Empty if the file is missing, empty or can't be mapped.
+        class MappedFile
+        {
+        public:
+            explicit MappedFile(const std::string& path)
+            {
+                HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+                if(file == INVALID_HANDLE_VALUE)
+                    return;
+
+                LARGE_INTEGER size;
+                if(GetFileSizeEx(file, &size) && size.QuadPart > 0)
+                {
+                    if(HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+                    {
+                        // The view keeps the mapping alive.
+                        _view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                        if(_view)
+                            _size = static_cast<size_t>(size.QuadPart);
+                        CloseHandle(mapping);
+                    }
+                }
+
+                CloseHandle(file);
+            }
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            [[nodiscard]] std::span<const char> Get() const { return { static_cast<const char*>(_view), _size }; }
+
+            ~MappedFile()
+            {
+                if(_view)
+                    UnmapViewOfFile(_view);
+            }
+
+        private:
+            void* _view = nullptr;
+            size_t _size = 0;
+        };
+
+        bool Exists(const std::string& path)
+        {
+            return GetFileAttributesA(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+        }
+
+        bool WriteAll(HANDLE file, std::span<const char> bytes)
+        {
+            while(!bytes.empty())
+            {
+                DWORD written;
+                const DWORD size = static_cast<DWORD>(std::min<size_t>(bytes.size(), 1 << 30));
+                if(!WriteFile(file, bytes.data(), size, &written, nullptr))
+                    return false;
+                bytes = bytes.subspan(written);
+            }
+            return true;
+        }
+
+        // False for a record that is cut short or of no known kind.
+        bool Replay(StateReader record, std::unordered_map<RoomID, MessageBacklog>& rooms)
+        {
+            const Change type = record.Read<Change>();
+            const RoomID room = record.Read<RoomID>();
+
+            switch(type)
+            {
+            case Change::Push:
+                if(const std::span<const char> message = record.ReadBytes(); record.IsValid())
+                    rooms[room].Push(message);
+                break;
+            case Change::Rebase:
+                if(const uint64_t sequence = record.Read<uint64_t>(); record.IsValid())
+                    rooms[room].Rebase(sequence);
+                break;
+            case Change::Drop:
+                if(record.IsValid())
+                    rooms.erase(room);
+                break;
+            default:
+                return false;
+            }
+
+            return record.IsValid();
+        }
+    }
+
+    void WriteRooms(StateWriter& state, std::span<const RoomSnapshot> rooms)
+    {
+        state.Write<uint64_t>(rooms.size());
+        for(const RoomSnapshot& room : rooms)
+        {
+            state.Write(room.Room);
+            state.Write(room.Sequence);
+            state.Write<uint64_t>(room.Entries.size());
+            for(const BacklogEntry& entry : room.Entries)
+                state.WriteBytes(entry.GetData());
+        }
+    }
+
+    bool ReadRooms(StateReader& state, std::unordered_map<RoomID, MessageBacklog>& rooms)
+    {
+        for(uint64_t count = state.Read<uint64_t>(); count && state.IsValid(); count--)
+        {
+            const RoomID room = state.Read<RoomID>();
+            const uint64_t sequence = state.Read<uint64_t>();
+            const uint64_t entryCount = state.Read<uint64_t>();
+
+            // Sequences are contiguous and end at the room's, the first one follows from the count.
+            MessageBacklog& backlog = rooms[room];
+            backlog.Rebase(sequence - std::min(entryCount, sequence));
+            for(uint64_t i = 0; i < entryCount && state.IsValid(); i++)
+                backlog.Push(state.ReadBytes());
+        }
+
+        return state.IsValid();
+    }
+
+    StateStore::StateStore(std::string path) : _path(std::move(path))
+    {
+        // Numbering goes on after whatever is there, a log is never overwritten.
+        {
+            const MappedFile snapshot(_path + ".snapshot");
+            StateReader state(snapshot.Get());
+            if(state.Read<uint32_t>() == SnapshotMagic)
+                _generation = state.Read<uint64_t>();
+        }
+
+        while(Exists(GetLogPath(_generation)))
+            _generation++;
+    }
+
+    uint64_t StateStore::Load(std::unordered_map<RoomID, MessageBacklog>& rooms) const
+    {
+        uint64_t epoch = 0;
+        uint64_t generation = 0;
+
+        {
+            const MappedFile snapshot(_path + ".snapshot");
+            StateReader state(snapshot.Get());
+            if(state.Read<uint32_t>() == SnapshotMagic)
+            {
+                generation = state.Read<uint64_t>();
+                epoch = state.Read<uint64_t>();
+                if(!ReadRooms(state, rooms))
+                    Log<LogLevel::Warning>("Snapshot {}.snapshot is cut short, loaded what there is.", _path);
+            }
+        }
+
+        for(; generation < _generation; generation++)
+        {
+            const MappedFile log(GetLogPath(generation));
+            StateReader state(log.Get());
+            if(state.Read<uint32_t>() != LogMagic)
+                continue;
+
+            epoch = state.Read<uint64_t>();
+
+            size_t count = 0;
+            while(!state.IsEmpty())
+            {
+                const std::span<const char> record = state.ReadBytes();
+                if(!state.IsValid() || !Replay(StateReader(record), rooms))
+                {
+                    Log<LogLevel::Warning>("Log {} is cut short after {} records.", GetLogPath(generation), count);
+                    break;
+                }
+                count++;
+            }
+        }
+
+        return epoch;
+    }
+
+    bool StateStore::BeginSnapshot(uint64_t epoch)
+    {
+        if(_isWriting)
+            return false;
+        if(_writer.joinable())
+            _writer.join();
+
+        const std::string path = GetLogPath(_generation);
+        HANDLE log = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        StateWriter header;
+        header.Write(LogMagic);
+        header.Write(epoch);
+        if(log == INVALID_HANDLE_VALUE || !WriteAll(log, header.Get()))
+        {
+            Log<LogLevel::Warning>("Failed to start log {}. Code: {}", path, GetLastError());
+            if(log != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(log);
+                DeleteFileA(path.c_str());
+            }
+
+            // Not again before the current log has grown as much once more.
+            _logSize.store(0, std::memory_order_relaxed);
+            return false;
+        }
+
+        // Whatever is queued belongs to the current log, and so does every change of a room until it is cut.
+        {
+            std::scoped_lock lock{ _queueState };
+            std::swap(_queued, _queuedBefore);
+            _isCutting = true;
+        }
+
+        _previousLog = _log;
+        _log = log;
+        _generation++;
+        _logSize.store(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    void StateStore::Cut(RoomID room)
+    {
+        std::scoped_lock lock{ _queueState };
+        _cut.insert(room);
+    }
+
+    void StateStore::EndSnapshot(uint64_t epoch, std::vector<RoomSnapshot> rooms)
+    {
+        {
+            std::scoped_lock lock{ _queueState };
+            std::swap(_queuedBefore, _writing);
+            _cut.clear();
+            _isCutting = false;
+        }
+
+        if(_previousLog)
+        {
+            Write(_previousLog, _writing);
+            CloseHandle(_previousLog);
+            _previousLog = nullptr;
+        }
+        _writing.Clear();
+
+        _isWriting = true;
+        _writer = std::thread(&StateStore::WriteSnapshot, this, epoch, _generation - 1, std::move(rooms));
+    }
+
+    void StateStore::LogPush(RoomID room, std::span<const char> message)
+    {
+        std::scoped_lock lock{ _queueState };
+        StateWriter& queue = GetQueue(room);
+        const size_t offset = queue.GetSize();
+        queue.Write<uint64_t>(0);
+        queue.Write(Change::Push);
+        queue.Write(room);
+        queue.WriteBytes(message);
+        Append(queue, offset);
+    }
+
+    void StateStore::LogRebase(RoomID room, uint64_t sequence)
+    {
+        std::scoped_lock lock{ _queueState };
+        StateWriter& queue = GetQueue(room);
+        const size_t offset = queue.GetSize();
+        queue.Write<uint64_t>(0);
+        queue.Write(Change::Rebase);
+        queue.Write(room);
+        queue.Write(sequence);
+        Append(queue, offset);
+    }
+
+    void StateStore::LogDrop(RoomID room)
+    {
+        std::scoped_lock lock{ _queueState };
+        StateWriter& queue = GetQueue(room);
+        const size_t offset = queue.GetSize();
+        queue.Write<uint64_t>(0);
+        queue.Write(Change::Drop);
+        queue.Write(room);
+        Append(queue, offset);
+    }
+
+    void StateStore::Flush()
+    {
+        {
+            std::scoped_lock lock{ _queueState };
+            std::swap(_queued, _writing);
+        }
+
+        // Nothing is logged before the first snapshot.
+        if(_log)
+            Write(_log, _writing);
+        _writing.Clear();
+    }
+
+    std::string StateStore::GetLogPath(uint64_t generation) const
+    {
+        return std::format("{}.{}.log", _path, generation);
+    }
+
+    StateWriter& StateStore::GetQueue(RoomID room)
+    {
+        return _isCutting && !_cut.contains(room) ? _queuedBefore : _queued;
+    }
+
+    void StateStore::Append(StateWriter& queue, size_t offset)
+    {
+        // Records are written in one piece, the size in front of them only known now.
+        queue.WriteAt<uint64_t>(offset, queue.GetSize() - offset - sizeof(uint64_t));
+        if(&queue == &_queued)
+            _logSize.fetch_add(queue.GetSize() - offset, std::memory_order_relaxed);
+    }
+
+    void StateStore::Write(void* log, const StateWriter& queue) const
+    {
+        if(!WriteAll(log, queue.Get()))
+            Log<LogLevel::Warning>("Failed to write a log of {}. Code: {}", _path, GetLastError());
+    }
+
+    void StateStore::WriteSnapshot(uint64_t epoch, uint64_t generation, std::vector<RoomSnapshot> rooms)
+    {
+        StateWriter state;
+        state.Write(SnapshotMagic);
+        state.Write(generation);
+        state.Write(epoch);
+        WriteRooms(state, rooms);
+        rooms.clear();
+
+        const std::string path = _path + ".snapshot";
+        const std::string temporaryPath = path + ".tmp";
+
+        HANDLE file = CreateFileA(temporaryPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        bool isWritten = file != INVALID_HANDLE_VALUE && WriteAll(file, state.Get()) && FlushFileBuffers(file);
+        if(file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+
+        // Swapped in one step, a crash leaves one snapshot or the other and every log either one needs.
+        isWritten = isWritten && MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+        if(!isWritten)
+        {
+            Log<LogLevel::Warning>("Failed to write snapshot {}. Code: {}", path, GetLastError());
+            DeleteFileA(temporaryPath.c_str());
+        }
+        else
+        {
+            // Older logs are contiguous, including any a crash kept from being deleted last time.
+            for(uint64_t older = generation; older > 0; older--)
+                if(!DeleteFileA(GetLogPath(older - 1).c_str()))
+                    break;
+            Log<LogLevel::Debug>("Wrote snapshot {} of {} bytes.", path, state.GetSize());
+        }
+
+        _isWriting = false;
+    }
+
+    StateStore::~StateStore()
+    {
+        if(_writer.joinable())
+            _writer.join();
+
+        Flush();
+        if(_previousLog)
+        {
+            Write(_previousLog, _queuedBefore);
+            CloseHandle(_previousLog);
+        }
+        if(_log)
+            CloseHandle(_log);
+    }
+}
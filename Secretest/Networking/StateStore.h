@@ -0,0 +1,101 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#pragma once
+
+#include "Backlog.h"
+#include "Protocol.h"
+#include "StateBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Secretest
+{
+    // A room as it was at one point, sharing its messages with the live backlog.
+    struct RoomSnapshot
+    {
+        RoomID Room;
+        uint64_t Sequence;
+        std::vector<BacklogEntry> Entries;
+    };
+
+    void WriteRooms(StateWriter& state, std::span<const RoomSnapshot> rooms);
+    // Replacing rooms of the same ID. False if the state is cut short.
+    bool ReadRooms(StateReader& state, std::unordered_map<RoomID, MessageBacklog>& rooms);
+
+    // Keeps a server's rooms on disk as a snapshot, "<path>.snapshot", and a log of every change since, "<path>.<n>.log".
+    // A snapshot starts the next log and is written from shared copies of the rooms on a thread of its own, the logs
+    // before it are deleted once it is complete. A restart maps the snapshot and replays only the logs after it.
+    //
+    // Changes are queued from any thread and written by Flush, so logging one never waits on the disk. Rooms are cut
+    // over to the next log one at a time, each under whatever orders its changes, so the others never wait on a snapshot.
+    class StateStore
+    {
+    public:
+        // Only looks at which files are there, nothing is written before the first Snapshot.
+        explicit StateStore(std::string path);
+        StateStore(const StateStore&) = delete;
+        StateStore& operator=(const StateStore&) = delete;
+
+        // The snapshot, then the logs in order; a log cut short by a crash counts up to its last whole record.
+        // Returns the epoch of the last process that wrote any of it, zero if there is nothing.
+        uint64_t Load(std::unordered_map<RoomID, MessageBacklog>& rooms) const;
+
+        // Starts the next log. Until a room is Cut, its changes still go to the current one; copy it and cut it under the
+        // same lock as its Log calls, so the copy is exactly what the previous logs add up to. Rooms can't be added or
+        // dropped until EndSnapshot. False if the next log can't be created; the current one is kept.
+        bool BeginSnapshot(uint64_t epoch);
+        void Cut(RoomID room);
+        // Once every room is cut. The previous log is finished and the copies are written on a thread of their own.
+        void EndSnapshot(uint64_t epoch, std::vector<RoomSnapshot> rooms);
+        [[nodiscard]] bool IsWriting() const { return _isWriting; }
+        // Since the last snapshot. Any thread, the Log calls may be adding to it.
+        [[nodiscard]] uint64_t GetLogSize() const { return _logSize.load(std::memory_order_relaxed); }
+
+        // Any thread. Queued until the next Flush, in the order of the calls.
+        void LogPush(RoomID room, std::span<const char> message);
+        void LogRebase(RoomID room, uint64_t sequence);
+        void LogDrop(RoomID room);
+
+        // Hands what is queued to the OS, so it survives the process going down. Not flushed to the disk.
+        void Flush();
+
+        ~StateStore();
+
+    private:
+        [[nodiscard]] std::string GetLogPath(uint64_t generation) const;
+        // Under _queueState. Where the room's next change goes, Append sizes the record once it is in.
+        StateWriter& GetQueue(RoomID room);
+        void Append(StateWriter& queue, size_t offset);
+        void Write(void* log, const StateWriter& queue) const;
+        void WriteSnapshot(uint64_t epoch, uint64_t generation, std::vector<RoomSnapshot> rooms);
+
+        std::string _path;
+        void* _log = nullptr;
+        // Until EndSnapshot, the log the rooms not cut yet still go to.
+        void* _previousLog = nullptr;
+        // Of the log being written.
+        uint64_t _generation = 0;
+        std::atomic<uint64_t> _logSize = 0;
+
+        std::mutex _queueState;
+        StateWriter _queued;
+        StateWriter _queuedBefore;
+        std::unordered_set<RoomID> _cut;
+        bool _isCutting = false;
+        // Only touched by Flush and the snapshot calls, swapped with a queue to write it.
+        StateWriter _writing;
+
+        std::thread _writer;
+        std::atomic<bool> _isWriting = false;
+    };
+}
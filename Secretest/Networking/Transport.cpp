@@ -0,0 +1,163 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#include "Transport.h"
+#include "SimulatedNetwork.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace Secretest
+{
+    bool ITransport::WaitReadable(std::chrono::milliseconds timeout) const
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while(!IsReadable())
+        {
+            if(std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return true;
+    }
+
+    void MemoryPipe::Push(std::span<const char> data)
+    {
+        {
+            std::scoped_lock lock{ _state };
+            if(_isClosed)
+                return;
+
+            _bytes.insert(_bytes.end(), data.begin(), data.end());
+        }
+
+        _readable.notify_all();
+    }
+
+    bool MemoryPipe::Pop(std::span<char> buf)
+    {
+        std::unique_lock lock{ _state };
+        _readable.wait(lock, [&] { return _bytes.size() - _readOffset >= buf.size() || _isClosed; });
+
+        if(_bytes.size() - _readOffset < buf.size())
+            return false;
+
+        Take(buf);
+        return true;
+    }
+
+    bool MemoryPipe::PopSome(std::span<char> buf, size_t& read)
+    {
+        std::scoped_lock lock{ _state };
+
+        read = std::min(buf.size(), _bytes.size() - _readOffset);
+        if(!read)
+            return !_isClosed || buf.empty();
+
+        Take(buf.first(read));
+        return true;
+    }
+
+    void MemoryPipe::Take(std::span<char> buf)
+    {
+        std::memcpy(buf.data(), _bytes.data() + _readOffset, buf.size());
+        _readOffset += buf.size();
+
+        // Compacted once the dead prefix outweighs what is left, so a busy pipe doesn't grow forever.
+        if(_readOffset == _bytes.size())
+        {
+            _bytes.clear();
+            _readOffset = 0;
+        }
+        else if(_readOffset > _bytes.size() / 2)
+        {
+            _bytes.erase(_bytes.begin(), _bytes.begin() + _readOffset);
+            _readOffset = 0;
+        }
+    }
+
+    void MemoryPipe::Close()
+    {
+        {
+            std::scoped_lock lock{ _state };
+            _isClosed = true;
+        }
+
+        _readable.notify_all();
+    }
+
+    size_t MemoryPipe::GetReadableBytes() const
+    {
+        std::scoped_lock lock{ _state };
+        return _bytes.size() - _readOffset;
+    }
+
+    bool MemoryPipe::IsClosed() const
+    {
+        std::scoped_lock lock{ _state };
+        return _isClosed;
+    }
+
+    MemoryTransport::MemoryTransport(std::shared_ptr<MemoryPipe> in, std::shared_ptr<MemoryPipe> out, SimulatedNetwork& network, std::shared_ptr<SimulatedLink> link) :
+        _in(std::move(in)),
+        _out(std::move(out)),
+        _network(&network),
+        _link(std::move(link))
+    {
+    }
+
+    std::pair<std::unique_ptr<ITransport>, std::unique_ptr<ITransport>> MemoryTransport::CreatePair()
+    {
+        auto a = std::make_shared<MemoryPipe>();
+        auto b = std::make_shared<MemoryPipe>();
+
+        return { std::make_unique<MemoryTransport>(a, b), std::make_unique<MemoryTransport>(b, a) };
+    }
+
+    bool MemoryTransport::Write(std::span<const std::span<const char>> parts)
+    {
+        if(!_isOpen || _out->IsClosed())
+            return false;
+
+        if(_network)
+        {
+            _network->Send(_link, parts, false);
+            return true;
+        }
+
+        for(const std::span<const char> part : parts)
+            _out->Push(part);
+        return true;
+    }
+
+    bool MemoryTransport::WriteSome(std::span<const char> buf, size_t& written)
+    {
+        // Pipes and simulated links don't fill up, a full window only holds back bulk frames through IsWritable.
+        const std::span<const char> parts[] = { buf };
+        written = Write(parts) ? buf.size() : 0;
+        return written == buf.size();
+    }
+
+    bool MemoryTransport::IsWritable() const
+    {
+        return !_network || _network->HasWindow(*_link);
+    }
+
+    void MemoryTransport::Close()
+    {
+        if(!_isOpen)
+            return;
+        _isOpen = false;
+
+        _in->Close();
+
+        // Over a network the peer only finds out once everything sent before has arrived.
+        if(_network)
+            _network->Send(_link, {}, true);
+        else
+            _out->Close();
+    }
+}
@@ -0,0 +1,120 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace Secretest
+{
+    class SimulatedNetwork;
+    struct SimulatedLink;
+    struct Address;
+
+    // Byte stream an IOConnection reads and writes frames through.
+    class ITransport
+    {
+    public:
+        virtual ~ITransport() = default;
+
+        // Blocks until buf is full. False once the stream is closed or broken.
+        virtual bool Read(std::span<char> buf) = 0;
+        // Never blocks. Whatever has arrived, up to buf's size, zero when nothing has. False once the stream is closed or broken.
+        virtual bool ReadSome(std::span<char> buf, size_t& read) = 0;
+        // The parts go out back to back, in one write where the transport can.
+        virtual bool Write(std::span<const std::span<const char>> parts) = 0;
+        // Writes what goes without waiting, possibly nothing. A client's end may wait for all of it, the way a blocking
+        // socket does; a server's never does. False once the stream is closed or broken.
+        virtual bool WriteSome(std::span<const char> buf, size_t& written) = 0;
+
+        // A closed stream counts as readable, the read is what reports it.
+        [[nodiscard]] virtual bool IsReadable() const = 0;
+        // Blocks until IsReadable would say so, false if the timeout passes first. Polls unless overridden.
+        [[nodiscard]] virtual bool WaitReadable(std::chrono::milliseconds timeout) const;
+        // Whether a write would go out without waiting. Bulk frames are held back until it does.
+        [[nodiscard]] virtual bool IsWritable() const { return true; }
+        [[nodiscard]] virtual bool IsOpen() const = 0;
+
+        virtual void Close() = 0;
+    };
+
+    // Where connections other than TCP come from. The server polls each one next to its listening socket.
+    class IListener
+    {
+    public:
+        virtual ~IListener() = default;
+
+        // Never blocks. Null once nothing is pending.
+        virtual std::unique_ptr<ITransport> Accept(Address& address) = 0;
+    };
+
+    // One direction of an in-process stream.
+    class MemoryPipe
+    {
+    public:
+        void Push(std::span<const char> data);
+        bool Pop(std::span<char> buf);
+        // Doesn't wait, false once closed with nothing left.
+        bool PopSome(std::span<char> buf, size_t& read);
+
+        // The writer is done, the reader gets what is left and then fails.
+        void Close();
+
+        [[nodiscard]] size_t GetReadableBytes() const;
+        [[nodiscard]] bool IsClosed() const;
+
+    private:
+        // Under _state, buf is no larger than what is readable.
+        void Take(std::span<char> buf);
+
+        mutable std::mutex _state;
+        std::condition_variable _readable;
+
+        std::vector<char> _bytes;
+        size_t _readOffset = 0;
+        bool _isClosed = false;
+    };
+
+    // In-process transport. Writes land in the peer's pipe immediately,
+    // or go through a SimulatedNetwork when created by one.
+    class MemoryTransport final : public ITransport
+    {
+    public:
+        MemoryTransport(std::shared_ptr<MemoryPipe> in, std::shared_ptr<MemoryPipe> out) : _in(std::move(in)), _out(std::move(out)) {}
+        MemoryTransport(std::shared_ptr<MemoryPipe> in, std::shared_ptr<MemoryPipe> out, SimulatedNetwork& network, std::shared_ptr<SimulatedLink> link);
+        MemoryTransport(const MemoryTransport&) = delete;
+        MemoryTransport& operator=(const MemoryTransport&) = delete;
+
+        static std::pair<std::unique_ptr<ITransport>, std::unique_ptr<ITransport>> CreatePair();
+
+        bool Read(std::span<char> buf) override { return _in->Pop(buf); }
+        bool ReadSome(std::span<char> buf, size_t& read) override { return _in->PopSome(buf, read); }
+        bool Write(std::span<const std::span<const char>> parts) override;
+        bool WriteSome(std::span<const char> buf, size_t& written) override;
+
+        [[nodiscard]] bool IsReadable() const override { return _in->IsClosed() || _in->GetReadableBytes(); }
+        [[nodiscard]] bool IsWritable() const override;
+        [[nodiscard]] bool IsOpen() const override { return _isOpen; }
+
+        void Close() override;
+
+        ~MemoryTransport() override { MemoryTransport::Close(); }
+
+    private:
+        std::shared_ptr<MemoryPipe> _in;
+        std::shared_ptr<MemoryPipe> _out;
+
+        SimulatedNetwork* _network = nullptr;
+        std::shared_ptr<SimulatedLink> _link;
+
+        bool _isOpen = true;
+    };
+}
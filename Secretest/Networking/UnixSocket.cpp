@@ -0,0 +1,160 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#include "UnixSocket.h"
+#include "Socket.h"
+
+#include <cstring>
+#include <format>
+#include <vector>
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+
+namespace Secretest
+{
+    namespace
+    {
+        bool ToSockAddr(std::string_view path, sockaddr_un& address)
+        {
+            address = {};
+            address.sun_family = AF_UNIX;
+
+            // Room for the terminator.
+            if(path.size() >= sizeof(address.sun_path))
+                return false;
+
+            std::memcpy(address.sun_path, path.data(), path.size());
+            return true;
+        }
+
+        SOCKET Connect(const sockaddr_un& address)
+        {
+            const SOCKET socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if(socket == InvalidSocket)
+                return InvalidSocket;
+
+            if(connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR)
+            {
+                closesocket(socket);
+                return InvalidSocket;
+            }
+
+            return socket;
+        }
+
+        // TOKEN_USER and the SID it points into, or empty if the process can't be asked.
+        std::vector<char> GetUser(HANDLE process)
+        {
+            HANDLE token;
+            if(!OpenProcessToken(process, TOKEN_QUERY, &token))
+                return {};
+
+            DWORD size = 0;
+            GetTokenInformation(token, TokenUser, nullptr, 0, &size);
+
+            std::vector<char> user(size);
+            if(!size || !GetTokenInformation(token, TokenUser, user.data(), size, &size))
+                user.clear();
+
+            CloseHandle(token);
+            return user;
+        }
+    }
+
+    UnixSocketListener::UnixSocketListener(std::string path, Authorizer authorize) :
+        _path(std::move(path)),
+        _authorize(std::move(authorize))
+    {
+        sockaddr_un address;
+        if(!ToSockAddr(_path, address))
+            throw ServerCreationException(std::format("Socket path is too long: {}", _path));
+
+        // Binding fails while the file exists. It's only ours to remove if nobody answers on it.
+        if(const SOCKET live = Connect(address); live != InvalidSocket)
+        {
+            closesocket(live);
+            throw ServerCreationException(std::format("Failed to listen on {}; is there a server already listening?", _path));
+        }
+        DeleteFileA(_path.c_str());
+
+        _socket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(_socket == InvalidSocket)
+            throw ServerCreationException(std::format("Failed to create socket for {}. Code: {}", _path, WSAGetLastError()));
+
+        if(bind(_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+            listen(_socket, SOMAXCONN) == SOCKET_ERROR)
+        {
+            const int err = WSAGetLastError();
+            closesocket(_socket);
+            throw ServerCreationException(std::format("Failed to listen on {}. Code: {}", _path, err));
+        }
+
+        // Accept drains the backlog until it would block, like the server's own socket.
+        u_long mode = 1;
+        ioctlsocket(_socket, FIONBIO, &mode);
+    }
+
+    std::unique_ptr<ITransport> UnixSocketListener::Accept(Address& address)
+    {
+        while(true)
+        {
+            const SOCKET socket = accept(_socket, nullptr, nullptr);
+            if(socket == InvalidSocket)
+                return nullptr;
+
+            DWORD processID = 0;
+            DWORD size = 0;
+            const bool isKnown = WSAIoctl(socket, SIO_AF_UNIX_GETPEERPID, nullptr, 0, &processID, sizeof(processID), &size, nullptr, nullptr) != SOCKET_ERROR;
+
+            if(!isKnown || (_authorize && !_authorize(processID)))
+            {
+                Log<LogLevel::Warning>("Refused connection on {} from process {}.", _path, processID);
+                closesocket(socket);
+                continue;
+            }
+
+            // Left non-blocking like the listening socket, SocketTransport waits when a blocking read needs to.
+            SetHandleInformation(reinterpret_cast<HANDLE>(socket), HANDLE_FLAG_INHERIT, 0);
+
+            address = Address::FromProcess(processID);
+            return std::make_unique<SocketTransport>(socket);
+        }
+    }
+
+    bool UnixSocketListener::IsSameUser(uint32_t processID)
+    {
+        static const std::vector<char> self = GetUser(GetCurrentProcess());
+
+        HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processID);
+        if(!process)
+            return false;
+
+        const std::vector<char> peer = GetUser(process);
+        CloseHandle(process);
+
+        return !self.empty() && !peer.empty() &&
+            EqualSid(reinterpret_cast<const TOKEN_USER*>(self.data())->User.Sid, reinterpret_cast<const TOKEN_USER*>(peer.data())->User.Sid);
+    }
+
+    UnixSocketListener::~UnixSocketListener()
+    {
+        closesocket(_socket);
+        DeleteFileA(_path.c_str());
+    }
+
+    std::unique_ptr<ITransport> ConnectUnixSocket(std::string_view path)
+    {
+        sockaddr_un address;
+        if(!ToSockAddr(path, address))
+            return nullptr;
+
+        const SOCKET socket = Connect(address);
+        if(socket == InvalidSocket)
+            return nullptr;
+
+        SetHandleInformation(reinterpret_cast<HANDLE>(socket), HANDLE_FLAG_INHERIT, 0);
+        return std::make_unique<SocketTransport>(socket);
+    }
+}
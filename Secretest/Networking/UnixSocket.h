@@ -0,0 +1,48 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#pragma once
+
+#include "Transport.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+using SOCKET = uint64_t;
+
+namespace Secretest
+{
+    // AF_UNIX stream sockets on a filesystem path, for admin tools and sidecars on this machine. Skips the TCP/IP
+    // stack, and the kernel names the peer's process, so it is let in or not before it says a word.
+    class UnixSocketListener final : public IListener
+    {
+    public:
+        using Authorizer = std::function<bool(uint32_t processID)>;
+
+        // Takes over the path if a previous run left its socket file behind. Throws ServerCreationException.
+        explicit UnixSocketListener(std::string path, Authorizer authorize = IsSameUser);
+        UnixSocketListener(const UnixSocketListener&) = delete;
+        UnixSocketListener& operator=(const UnixSocketListener&) = delete;
+
+        // Refused peers are closed here and never reach the server. Peers show up as their process, see
+        // Address::FromProcess.
+        std::unique_ptr<ITransport> Accept(Address& address) override;
+
+        // Whether the process runs as the same user as this one, the usual check on a peer's credentials.
+        static bool IsSameUser(uint32_t processID);
+
+        ~UnixSocketListener() override;
+
+    private:
+        std::string _path;
+        SOCKET _socket;
+        Authorizer _authorize;
+    };
+
+    // Null if nothing listens on the path. For ConnectOptions::Dial.
+    std::unique_ptr<ITransport> ConnectUnixSocket(std::string_view path);
+}
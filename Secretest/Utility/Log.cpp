@@ -0,0 +1,160 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#include "Log.h"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace Secretest
+{
+    namespace
+    {
+        constexpr std::array<std::string_view, 5> LevelNames = { "TRACE", "DEBUG", "INFO", "WARNING", "ERROR" };
+    }
+
+    struct Logger::State
+    {
+        std::mutex RingMutex;
+        std::vector<std::shared_ptr<LogRing>> Rings;
+
+        // Held while consuming, so Flush can drain from another thread without a second consumer.
+        std::mutex DrainMutex;
+
+        // The logging thread sleeps on this once every ring is empty.
+        std::mutex WakeMutex;
+        std::condition_variable Wakeable;
+        bool IsWoken = false;
+
+        std::thread Thread;
+        std::atomic<bool> ShouldStop = false;
+        std::atomic<uint32_t> NextThread = 0;
+
+        std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    };
+
+    LogRing& LogDetail::GetThreadRing()
+    {
+        thread_local const std::shared_ptr<LogRing> ring = Logger::Get().CreateRing();
+
+        return *ring;
+    }
+
+    Logger& Logger::Get()
+    {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger::Logger() : _state(std::make_unique<State>())
+    {
+        _state->Thread = std::thread(&Logger::Run, this);
+    }
+
+    Logger::~Logger()
+    {
+        _state->ShouldStop = true;
+        Wake();
+        _state->Thread.join();
+    }
+
+    std::shared_ptr<LogRing> Logger::CreateRing()
+    {
+        std::shared_ptr<LogRing> ring = std::make_shared<LogRing>(_state->NextThread++);
+
+        std::unique_lock lock(_state->RingMutex);
+        _state->Rings.push_back(ring);
+        return ring;
+    }
+
+    void Logger::Flush()
+    {
+        std::string batch;
+        Drain(batch);
+
+        // Whatever was logged while this drained is the logging thread's.
+        Wake();
+    }
+
+    void Logger::Wake()
+    {
+        {
+            std::unique_lock lock(_state->WakeMutex);
+            _state->IsWoken = true;
+        }
+        _state->Wakeable.notify_one();
+    }
+
+    bool Logger::Drain(std::string& batch)
+    {
+        std::unique_lock drainLock(_state->DrainMutex);
+
+        std::vector<std::shared_ptr<LogRing>> rings;
+        {
+            std::unique_lock lock(_state->RingMutex);
+            rings = _state->Rings;
+        }
+
+        // Held only by the registry and the copy above: the thread exited, so this drain gets its last record.
+        std::vector<LogRing*> abandoned;
+        for(const std::shared_ptr<LogRing>& ring : rings)
+        {
+            if(ring.use_count() == 2)
+                abandoned.push_back(ring.get());
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        const int64_t start = _state->Start.time_since_epoch().count();
+        const auto format = [&](uint32_t thread, const LogRecord& record, const char* payload)
+        {
+            const std::chrono::duration<double> time = std::chrono::steady_clock::duration(record.Timestamp - start);
+            std::format_to(std::back_inserter(batch), "{:>12.6f} {:<7} [{}] ", time.count(), LevelNames[static_cast<size_t>(record.Level)], thread);
+            record.Formatter(batch, std::string_view(record.Format, record.FormatSize), payload);
+            batch += '\n';
+        };
+
+        batch.clear();
+        for(const std::shared_ptr<LogRing>& ring : rings)
+        {
+            ring->Consume([&](const LogRecord& record, const char* payload) { format(ring->GetThread(), record, payload); });
+
+            if(const uint64_t dropped = ring->TakeDropped())
+                std::format_to(std::back_inserter(batch), "{:>12} {:<7} [{}] {} records dropped, ring full\n", "", "WARNING", ring->GetThread(), dropped);
+        }
+
+        if(!abandoned.empty())
+        {
+            std::unique_lock lock(_state->RingMutex);
+            std::erase_if(_state->Rings, [&](const std::shared_ptr<LogRing>& ring) { return std::ranges::find(abandoned, ring.get()) != abandoned.end(); });
+        }
+
+        if(batch.empty())
+            return false;
+
+        std::fwrite(batch.data(), 1, batch.size(), stdout);
+        std::fflush(stdout);
+        return true;
+    }
+
+    void Logger::Run()
+    {
+        std::string batch;
+        while(!_state->ShouldStop)
+        {
+            if(Drain(batch))
+                continue;
+
+            // A record committed after its ring was looked at has woken us already.
+            std::unique_lock lock(_state->WakeMutex);
+            _state->Wakeable.wait(lock, [&] { return _state->IsWoken; });
+            _state->IsWoken = false;
+        }
+
+        Drain(batch);
+    }
+}
@@ -0,0 +1,267 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Anything below this is compiled out entirely.
+#ifndef SECRETEST_LOG_LEVEL
+#ifdef DEBUG
+#define SECRETEST_LOG_LEVEL 1
+#else
+#define SECRETEST_LOG_LEVEL 2
+#endif
+#endif
+
+namespace Secretest
+{
+    enum class LogLevel : uint8_t
+    {
+        Trace,
+        Debug,
+        Info,
+        Warning,
+        Error,
+        None
+    };
+
+    constexpr LogLevel CompiledLogLevel = static_cast<LogLevel>(SECRETEST_LOG_LEVEL);
+
+    using LogFormatter = void(*)(std::string& out, std::string_view format, const char* payload);
+
+    // Arguments are copied into the record as raw bytes and only formatted by the logging thread.
+    // Strings are copied by value; everything else has to be trivially copyable.
+    struct LogRecord
+    {
+        // Header and payload, rounded up to the ring's alignment. Zero marks the rest of the ring as padding.
+        uint32_t Size;
+        LogLevel Level;
+        uint32_t FormatSize;
+        const char* Format;
+        LogFormatter Formatter;
+        int64_t Timestamp;
+    };
+
+    // Single producer, single consumer. Full means the record is dropped; a producer never waits.
+    class LogRing
+    {
+    public:
+        static constexpr size_t Capacity = 64 * 1024;
+        static constexpr size_t Alignment = alignof(LogRecord);
+
+        explicit LogRing(uint32_t thread) : _thread(thread), _buffer(std::make_unique<char[]>(Capacity)) {}
+
+        // Null if there is no room, otherwise Commit must follow.
+        char* Reserve(size_t size)
+        {
+            const size_t head = _head.load(std::memory_order_relaxed);
+            const size_t tail = _tail.load(std::memory_order_acquire);
+            const size_t offset = head % Capacity;
+
+            // Records never wrap; the end of the ring is skipped instead.
+            const size_t padding = offset + size > Capacity ? Capacity - offset : 0;
+            if(head + padding + size - tail > Capacity)
+            {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            _padding = padding;
+            if(padding)
+            {
+                reinterpret_cast<LogRecord*>(_buffer.get() + offset)->Size = 0;
+                return _buffer.get();
+            }
+
+            return _buffer.get() + offset;
+        }
+
+        // Publishes the padding and the record together. True if the consumer had taken everything before it,
+        // in which case it may be asleep. Sequentially consistent against Consume, so one of the two sees the other.
+        bool Commit(size_t size)
+        {
+            const size_t head = _head.load(std::memory_order_relaxed);
+            _head.store(head + _padding + size, std::memory_order_seq_cst);
+            return _tail.load(std::memory_order_seq_cst) == head;
+        }
+
+        // Consumer side. Returns the number of records handed to func.
+        template<typename FUNC_T>
+        size_t Consume(FUNC_T&& func)
+        {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            const size_t head = _head.load(std::memory_order_seq_cst);
+
+            size_t count = 0;
+            while(tail != head)
+            {
+                const LogRecord* record = reinterpret_cast<const LogRecord*>(_buffer.get() + tail % Capacity);
+                if(!record->Size)
+                {
+                    tail += Capacity - tail % Capacity;
+                    continue;
+                }
+
+                func(*record, reinterpret_cast<const char*>(record + 1));
+                tail += record->Size;
+                count++;
+            }
+
+            _tail.store(tail, std::memory_order_seq_cst);
+            return count;
+        }
+
+        [[nodiscard]] uint32_t GetThread() const { return _thread; }
+        [[nodiscard]] uint64_t TakeDropped() { return _dropped.exchange(0, std::memory_order_relaxed); }
+
+    private:
+        uint32_t _thread;
+        std::unique_ptr<char[]> _buffer;
+
+        alignas(64) std::atomic<size_t> _head = 0;
+        size_t _padding = 0;
+        alignas(64) std::atomic<size_t> _tail = 0;
+        std::atomic<uint64_t> _dropped = 0;
+    };
+
+    namespace LogDetail
+    {
+        template<typename T>
+        constexpr bool IsString = std::is_convertible_v<const T&, std::string_view>;
+
+        // What an argument is stored and formatted as.
+        template<typename T>
+        using Stored = std::conditional_t<IsString<T>, std::string_view, std::remove_cvref_t<T>>;
+
+        template<typename T>
+        size_t GetSize(const T& value)
+        {
+            if constexpr(IsString<T>)
+                return sizeof(uint32_t) + std::string_view(value).size();
+            else
+                return sizeof(T);
+        }
+
+        template<typename T>
+        char* Encode(char* out, const T& value)
+        {
+            if constexpr(IsString<T>)
+            {
+                const std::string_view string(value);
+                const uint32_t size = string.size();
+                std::memcpy(out, &size, sizeof(size));
+                std::memcpy(out + sizeof(size), string.data(), size);
+                return out + sizeof(size) + size;
+            }
+            else
+            {
+                static_assert(std::is_trivially_copyable_v<T>, "Log arguments must be strings or trivially copyable.");
+                std::memcpy(out, &value, sizeof(T));
+                return out + sizeof(T);
+            }
+        }
+
+        template<typename T>
+        T Decode(const char*& in)
+        {
+            if constexpr(std::is_same_v<T, std::string_view>)
+            {
+                uint32_t size;
+                std::memcpy(&size, in, sizeof(size));
+                const std::string_view result(in + sizeof(size), size);
+                in += sizeof(size) + size;
+                return result;
+            }
+            else
+            {
+                T result;
+                std::memcpy(&result, in, sizeof(T));
+                in += sizeof(T);
+                return result;
+            }
+        }
+
+        template<typename... ARGS>
+        void Format(std::string& out, std::string_view format, [[maybe_unused]] const char* payload)
+        {
+            // Braced initialization decodes left to right.
+            std::tuple<ARGS...> args{ Decode<ARGS>(payload)... };
+            std::apply([&](ARGS&... values)
+            {
+                std::vformat_to(std::back_inserter(out), format, std::make_format_args(values...));
+            }, args);
+        }
+
+        // The calling thread's ring, registered with the logger the first time.
+        LogRing& GetThreadRing();
+    }
+
+    // Formats and writes every thread's records in batches, on its own thread.
+    class Logger
+    {
+    public:
+        static Logger& Get();
+
+        // Rings stay registered until the logger has seen their thread exit and drained them.
+        std::shared_ptr<LogRing> CreateRing();
+        // Blocks until everything logged before the call is written.
+        void Flush();
+        // Called by a producer whose ring was empty, the logging thread sleeps until then.
+        void Wake();
+
+        ~Logger();
+
+    private:
+        Logger();
+
+        bool Drain(std::string& batch);
+        void Run();
+
+        struct State;
+        std::unique_ptr<State> _state;
+    };
+
+    template<LogLevel LEVEL, typename... ARGS>
+    void Log(std::format_string<ARGS...> format, const ARGS&... args)
+    {
+        if constexpr(LEVEL < CompiledLogLevel)
+            return;
+        else
+        {
+            const size_t size = (sizeof(LogRecord) + ... + LogDetail::GetSize(args));
+            const size_t alignedSize = (size + LogRing::Alignment - 1) & ~(LogRing::Alignment - 1);
+
+            LogRing& ring = LogDetail::GetThreadRing();
+            char* out = ring.Reserve(alignedSize);
+            if(!out)
+                return;
+
+            const std::string_view string = format.get();
+            LogRecord* record = reinterpret_cast<LogRecord*>(out);
+            record->Size = alignedSize;
+            record->Level = LEVEL;
+            record->FormatSize = string.size();
+            record->Format = string.data();
+            record->Formatter = &LogDetail::Format<LogDetail::Stored<ARGS>...>;
+            record->Timestamp = std::chrono::steady_clock::now().time_since_epoch().count();
+
+            out += sizeof(LogRecord);
+            ((out = LogDetail::Encode(out, args)), ...);
+
+            if(ring.Commit(alignedSize))
+                Logger::Get().Wake();
+        }
+    }
+}
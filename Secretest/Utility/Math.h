@@ -95,14 +95,50 @@ constexpr vec<WIDTH, T> mat_multiply(const mat<WIDTH, T>& a, const vec<WIDTH, T>
     return result;
 }
 
+// Gauss-Jordan elimination with partial pivoting. Singular matrices give garbage, like glm.
 template<size_t WIDTH, class T>
 constexpr mat<WIDTH, T> mat_invert(const mat<WIDTH, T>& a)
 {
-    mat<WIDTH, T> result{};
+    mat<WIDTH, T> m = a;
+    mat<WIDTH, T> result = mat_identity<WIDTH, T>;
 
-    for (size_t y = 0; y < WIDTH; y++)
-    for (size_t x = 0; x < WIDTH; x++)
-        result[x][y] =- a[x][y];
+    // Columns are [x], rows are [y]; row operations are done across every column.
+    for (size_t col = 0; col < WIDTH; col++)
+    {
+        size_t pivot = col;
+        for (size_t y = col + 1; y < WIDTH; y++)
+            if ((m[col][y] < 0 ? -m[col][y] : m[col][y]) > (m[col][pivot] < 0 ? -m[col][pivot] : m[col][pivot]))
+                pivot = y;
+
+        if (pivot != col)
+        {
+            for (size_t x = 0; x < WIDTH; x++)
+            {
+                std::swap(m[x][col], m[x][pivot]);
+                std::swap(result[x][col], result[x][pivot]);
+            }
+        }
+
+        const T scale = (T) 1 / m[col][col];
+        for (size_t x = 0; x < WIDTH; x++)
+        {
+            m[x][col] *= scale;
+            result[x][col] *= scale;
+        }
+
+        for (size_t y = 0; y < WIDTH; y++)
+        {
+            if (y == col)
+                continue;
+
+            const T factor = m[col][y];
+            for (size_t x = 0; x < WIDTH; x++)
+            {
+                m[x][y] -= factor * m[x][col];
+                result[x][y] -= factor * result[x][col];
+            }
+        }
+    }
 
     return result;
 }
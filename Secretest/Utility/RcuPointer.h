@@ -0,0 +1,100 @@
+//
+// Created by scion on 1/26/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Secretest
+{
+    // Read-copy-update with epoch based reclamation. Readers on any thread pin the current value without waiting on
+    // anything, the writer publishes a new one whole and never waits for readers either: the old value, and anything
+    // else retired alongside it, is destroyed by a later Reclaim once every reader that could have seen it is done.
+    //
+    // Readers count themselves in one of two counters, picked by the parity of the epoch. The epoch only moves on once
+    // the counter it is about to reuse is empty, so after two moves every reader from before the first has left.
+    // A reader always loads the value after counting itself, so one that stalled in between still sees a value that
+    // was current when the epoch moved, and holds up the reclaim of that one.
+    template<typename T>
+    class RcuPointer
+    {
+    public:
+        // Pinned for as long as it lives. Keep it short, it holds up reclaiming.
+        class ReadGuard
+        {
+        public:
+            ReadGuard(const ReadGuard&) = delete;
+            ReadGuard& operator=(const ReadGuard&) = delete;
+
+            const T* operator->() const { return _value; }
+            const T& operator*() const { return *_value; }
+
+            ~ReadGuard() { _readers.fetch_sub(1); }
+
+        private:
+            friend class RcuPointer;
+
+            explicit ReadGuard(const RcuPointer& pointer) :
+                _readers(pointer._readers[pointer._epoch.load() & 1])
+            {
+                _readers.fetch_add(1);
+                _value = pointer._current.load();
+            }
+
+            std::atomic<uint64_t>& _readers;
+            const T* _value;
+        };
+
+        explicit RcuPointer(std::unique_ptr<const T> value = std::make_unique<const T>()) : _current(value.release()) {}
+        RcuPointer(const RcuPointer&) = delete;
+        RcuPointer& operator=(const RcuPointer&) = delete;
+
+        // Any thread, never waits.
+        [[nodiscard]] ReadGuard Read() const { return ReadGuard(*this); }
+
+        // The rest is for one writer at a time.
+
+        void Publish(std::unique_ptr<const T> value)
+        {
+            Retire(std::shared_ptr<const T>(_current.exchange(value.release())));
+            Reclaim();
+        }
+
+        // Kept alive until no reader can still be looking at it, for whatever the published value points into.
+        void Retire(std::shared_ptr<const void> garbage)
+        {
+            _retired.emplace_back(_epoch.load(), std::move(garbage));
+        }
+
+        // Never waits, whatever is still pinned is left for next time.
+        void Reclaim()
+        {
+            if(_retired.empty())
+                return;
+
+            // Readers of the epoch before this one count in the counter the next epoch reuses.
+            const uint64_t epoch = _epoch.load();
+            if(!_readers[(epoch + 1) & 1].load())
+                _epoch.store(epoch + 1);
+
+            // Two moves after being retired, no reader can still see it.
+            const uint64_t current = _epoch.load();
+            std::erase_if(_retired, [current](const auto& retired) { return retired.first + 2 <= current; });
+        }
+
+        // Nobody may be reading anymore.
+        ~RcuPointer() { delete _current.load(); }
+
+    private:
+        std::atomic<const T*> _current;
+        std::atomic<uint64_t> _epoch = 0;
+        mutable std::atomic<uint64_t> _readers[2] = {};
+
+        std::vector<std::pair<uint64_t, std::shared_ptr<const void>>> _retired;
+    };
+}
@@ -0,0 +1,192 @@
+//
+// Created by scion on 1/20/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Secretest
+{
+    struct TimerHandle
+    {
+        uint32_t Index = UINT32_MAX;
+        uint32_t Generation = 0;
+    };
+
+    // Hierarchical timing wheel (Varghese & Lauck). Scheduling, cancelling and expiring are O(1);
+    // timers in the upper levels are cascaded down once per rotation of the level below.
+    // Ticks are whatever unit the owner advances by. Timers further out than the wheel spans
+    // are parked in the top level and re-cascaded until they are in range.
+    template<typename T, size_t LEVELS = 4>
+    class TimerWheel
+    {
+    public:
+        explicit TimerWheel(uint64_t tick = 0) : _tick(tick)
+        {
+            for(auto& level : _slots)
+                level.fill(Null);
+        }
+
+        TimerHandle Schedule(uint64_t expiry, T value)
+        {
+            uint32_t index;
+            if(_free != Null)
+            {
+                index = _free;
+                _free = _nodes[index].Next;
+            }
+            else
+            {
+                index = _nodes.size();
+                _nodes.emplace_back();
+            }
+
+            Node& node = _nodes[index];
+            node.Value = std::move(value);
+            node.Expiry = std::max(expiry, _tick + 1);
+            node.IsActive = true;
+
+            Link(index);
+            _size++;
+
+            return TimerHandle{ index, node.Generation };
+        }
+
+        bool Cancel(TimerHandle handle)
+        {
+            if(handle.Index >= _nodes.size())
+                return false;
+
+            Node& node = _nodes[handle.Index];
+            if(!node.IsActive || node.Generation != handle.Generation)
+                return false;
+
+            Unlink(handle.Index);
+            Release(handle.Index);
+            return true;
+        }
+
+        // Fires every timer due at or before tick. func may schedule or cancel timers.
+        template<typename FUNC_T>
+        void Advance(uint64_t tick, FUNC_T&& func)
+        {
+            while(_tick < tick)
+            {
+                if(!_size)
+                {
+                    _tick = tick;
+                    return;
+                }
+
+                _tick++;
+
+                for(size_t level = 1; level < LEVELS; level++)
+                {
+                    // Only once every level below has wrapped around.
+                    if(_tick & ((uint64_t(1) << level * SlotBits) - 1))
+                        break;
+
+                    Cascade(level, _tick >> level * SlotBits & SlotMask);
+                }
+
+                // Popped one at a time so func can cancel timers in the same slot.
+                // Nothing func schedules can land in the slot being expired.
+                const uint32_t& slot = _slots[0][_tick & SlotMask];
+                while(slot != Null)
+                {
+                    const uint32_t index = slot;
+                    Unlink(index);
+
+                    T value = std::move(_nodes[index].Value);
+                    Release(index);
+                    func(value);
+                }
+            }
+        }
+
+        [[nodiscard]] uint64_t GetTick() const { return _tick; }
+        [[nodiscard]] size_t Size() const { return _size; }
+
+    private:
+        static constexpr uint32_t Null = UINT32_MAX;
+        static constexpr size_t SlotBits = 6;
+        static constexpr uint64_t SlotCount = 1 << SlotBits;
+        static constexpr uint64_t SlotMask = SlotCount - 1;
+
+        struct Node
+        {
+            T Value{};
+            uint64_t Expiry = 0;
+            uint32_t Previous = Null;
+            uint32_t Next = Null;
+            uint32_t Generation = 0;
+            uint8_t Level = 0;
+            bool IsActive = false;
+        };
+
+        void Link(uint32_t index)
+        {
+            Node& node = _nodes[index];
+
+            // The highest group of bits the expiry differs from now in decides the level.
+            const uint64_t difference = node.Expiry ^ _tick;
+            const size_t level = std::min<size_t>(LEVELS - 1, difference ? (std::bit_width(difference) - 1) / SlotBits : 0);
+
+            uint32_t& slot = _slots[level][node.Expiry >> level * SlotBits & SlotMask];
+
+            node.Level = level;
+            node.Previous = Null;
+            node.Next = slot;
+            if(slot != Null)
+                _nodes[slot].Previous = index;
+            slot = index;
+        }
+
+        void Unlink(uint32_t index)
+        {
+            Node& node = _nodes[index];
+
+            if(node.Previous != Null)
+                _nodes[node.Previous].Next = node.Next;
+            else
+                _slots[node.Level][node.Expiry >> node.Level * SlotBits & SlotMask] = node.Next;
+
+            if(node.Next != Null)
+                _nodes[node.Next].Previous = node.Previous;
+        }
+
+        void Release(uint32_t index)
+        {
+            Node& node = _nodes[index];
+            node.IsActive = false;
+            node.Generation++;
+            node.Next = _free;
+            _free = index;
+            _size--;
+        }
+
+        void Cascade(size_t level, uint64_t slot)
+        {
+            uint32_t index = std::exchange(_slots[level][slot], Null);
+
+            while(index != Null)
+            {
+                const uint32_t next = _nodes[index].Next;
+                Link(index);
+                index = next;
+            }
+        }
+
+        std::vector<Node> _nodes;
+        std::array<std::array<uint32_t, SlotCount>, LEVELS> _slots;
+        uint32_t _free = Null;
+        uint64_t _tick;
+        size_t _size = 0;
+    };
+}
@@ -35,17 +35,7 @@ struct mat<3, T>
 
 	constexpr mat operator*(const mat& b) const
 	{
-		mat result{};
-
-		for (size_t y = 0; y < 3; y++)
-		for (size_t x = 0; x < 3; x++)
-		{
-			result[x][y] = 0;
-			for (size_t i = 0; i < 3; i++)
-				result[x][y] += v[x][i] * b[i][y];
-		}
-
-		return result;
+		return mat_multiply(*this, b);
 	}
 	constexpr mat& operator*=(const mat& b) { return *this = *this * b; }
 
@@ -65,7 +55,7 @@ struct mat<3, T>
 		return v[0][0] * v[1][1] * v[2][2] +
 			   v[0][1] * v[1][2] * v[2][0] +
 			   v[0][2] * v[1][0] * v[2][1] -
-			   v[0][0] * v[2][1] * v[2][1] -
+			   v[0][0] * v[1][2] * v[2][1] -
 			   v[0][1] * v[1][0] * v[2][2] -
 			   v[0][2] * v[1][1] * v[2][0];
 	}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Math.h"
+#include "vec4.h"
+
 #include <cmath>
 #include <numbers>
 
@@ -60,6 +62,11 @@ struct mat<4, T>
 
 	constexpr mat operator-() const { return mat_invert(*this); }
 
+	constexpr mat inverse() const { return mat_invert(*this); }
+	// Any affine transform; the bottom row is assumed to be (0, 0, 0, 1).
+	constexpr mat affine_inverse() const { return mat_invert_affine(*this); }
+
+	// Rotation and translation only.
 	constexpr mat fast_inverse() const
 	{
 		mat<3, T> inverse = mat_transpose((mat<3, T>) * this);
@@ -150,4 +157,240 @@ private:
 	std::array<COL_T, 4> v{};
 };
 
-using mat4 = mat<4, float>;
\ No newline at end of file
+using mat4 = mat<4, float>;
+
+template<class T>
+constexpr mat<4, T> mat_invert_affine(const mat<4, T>& a)
+{
+	// Rows of the inverse 3x3 are the cross products of the other two columns over the determinant.
+	const auto cross = [](const vec<4, T>& a, const vec<4, T>& b)
+	{
+		return vec<4, T>(a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0], 0);
+	};
+
+	const vec<4, T> rows[3] = { cross(a[1], a[2]), cross(a[2], a[0]), cross(a[0], a[1]) };
+	const T invDet = (T) 1 / (a[0][0] * rows[0][0] + a[0][1] * rows[0][1] + a[0][2] * rows[0][2]);
+
+	mat<4, T> result{};
+	for (size_t y = 0; y < 3; y++)
+	{
+		for (size_t x = 0; x < 3; x++)
+			result[x][y] = rows[y][x] * invDet;
+		result[3][y] = -(rows[y][0] * a[3][0] + rows[y][1] * a[3][1] + rows[y][2] * a[3][2]) * invDet;
+	}
+	result[3][3] = 1;
+
+	return result;
+}
+
+// Float specializations. Constant evaluation falls back to the generic templates.
+// NEON only gets the products; inverses stay scalar there.
+#if defined(SECRETEST_SSE)
+
+inline void mat_load(const mat4& a, __m128& x, __m128& y, __m128& z, __m128& w)
+{
+	x = vec_load(a[0]);
+	y = vec_load(a[1]);
+	z = vec_load(a[2]);
+	w = vec_load(a[3]);
+}
+
+inline __m128 mat_multiply(__m128 x, __m128 y, __m128 z, __m128 w, __m128 b)
+{
+	__m128 result = _mm_mul_ps(x, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+	result = _mm_add_ps(result, _mm_mul_ps(y, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+	result = _mm_add_ps(result, _mm_mul_ps(z, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+	return _mm_add_ps(result, _mm_mul_ps(w, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+}
+
+constexpr vec4 mat_multiply(const mat4& a, const vec4& b)
+{
+	if consteval { return mat_multiply<4, float>(a, b); }
+	else
+	{
+		__m128 x, y, z, w;
+		mat_load(a, x, y, z, w);
+		return vec_store(mat_multiply(x, y, z, w, vec_load(b)));
+	}
+}
+
+constexpr mat4 mat_multiply(const mat4& a, const mat4& b)
+{
+	if consteval { return mat_multiply<4, float>(a, b); }
+	else
+	{
+		mat4 result;
+#if defined(__AVX2__) && defined(__FMA__)
+		// Two columns of the result per register.
+		const __m256 x = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[0].v.data()));
+		const __m256 y = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[1].v.data()));
+		const __m256 z = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[2].v.data()));
+		const __m256 w = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[3].v.data()));
+
+		for (size_t i = 0; i < 4; i += 2)
+		{
+			const __m256 columns = _mm256_loadu_ps(b[i].v.data());
+
+			__m256 product = _mm256_mul_ps(x, _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(0, 0, 0, 0)));
+			product = _mm256_fmadd_ps(y, _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(1, 1, 1, 1)), product);
+			product = _mm256_fmadd_ps(z, _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(2, 2, 2, 2)), product);
+			product = _mm256_fmadd_ps(w, _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(3, 3, 3, 3)), product);
+
+			_mm256_storeu_ps(result[i].v.data(), product);
+		}
+#else
+		__m128 x, y, z, w;
+		mat_load(a, x, y, z, w);
+
+		for (size_t i = 0; i < 4; i++)
+			_mm_store_ps(result[i].v.data(), mat_multiply(x, y, z, w, vec_load(b[i])));
+#endif
+		return result;
+	}
+}
+
+constexpr mat4 mat_transpose(const mat4& a)
+{
+	if consteval { return mat_transpose<4, float>(a); }
+	else
+	{
+		__m128 x, y, z, w;
+		mat_load(a, x, y, z, w);
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		return { vec_store(x), vec_store(y), vec_store(z), vec_store(w) };
+	}
+}
+
+// Block-wise inverse over the four 2x2 sub-matrices, see
+// https://lxjk.github.io/2017/09/03/Fast-4x4-Matrix-Inverse-with-SSE-SIMD-Explained.html
+// Inverting the transpose and transposing back cancel out, so it works on columns as written for rows.
+inline __m128 mat2_multiply(__m128 a, __m128 b)
+{
+	return _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+		_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+// adj(a) * b
+inline __m128 mat2_adjugate_multiply(__m128 a, __m128 b)
+{
+	return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+		_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+}
+
+// a * adj(b)
+inline __m128 mat2_multiply_adjugate(__m128 a, __m128 b)
+{
+	return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+		_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+constexpr mat4 mat_invert(const mat4& m)
+{
+	if consteval { return mat_invert<4, float>(m); }
+	else
+	{
+		__m128 x, y, z, w;
+		mat_load(m, x, y, z, w);
+
+		const __m128 a = _mm_movelh_ps(x, y);
+		const __m128 b = _mm_movehl_ps(y, x);
+		const __m128 c = _mm_movelh_ps(z, w);
+		const __m128 d = _mm_movehl_ps(w, z);
+
+		// (|A|, |B|, |C|, |D|)
+		const __m128 determinants = _mm_sub_ps(
+			_mm_mul_ps(_mm_shuffle_ps(x, z, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(y, w, _MM_SHUFFLE(3, 1, 3, 1))),
+			_mm_mul_ps(_mm_shuffle_ps(x, z, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(y, w, _MM_SHUFFLE(2, 0, 2, 0))));
+		const __m128 detA = _mm_shuffle_ps(determinants, determinants, _MM_SHUFFLE(0, 0, 0, 0));
+		const __m128 detB = _mm_shuffle_ps(determinants, determinants, _MM_SHUFFLE(1, 1, 1, 1));
+		const __m128 detC = _mm_shuffle_ps(determinants, determinants, _MM_SHUFFLE(2, 2, 2, 2));
+		const __m128 detD = _mm_shuffle_ps(determinants, determinants, _MM_SHUFFLE(3, 3, 3, 3));
+
+		const __m128 dc = mat2_adjugate_multiply(d, c);
+		const __m128 ab = mat2_adjugate_multiply(a, b);
+
+		__m128 rx = _mm_sub_ps(_mm_mul_ps(detD, a), mat2_multiply(b, dc));
+		__m128 rw = _mm_sub_ps(_mm_mul_ps(detA, d), mat2_multiply(c, ab));
+		__m128 ry = _mm_sub_ps(_mm_mul_ps(detB, c), mat2_multiply_adjugate(d, ab));
+		__m128 rz = _mm_sub_ps(_mm_mul_ps(detC, b), mat2_multiply_adjugate(a, dc));
+
+		// |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+		const __m128 trace = vec_sum(_mm_mul_ps(ab, _mm_shuffle_ps(dc, dc, _MM_SHUFFLE(3, 1, 2, 0))));
+		const __m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace);
+		const __m128 invDet = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), det);
+
+		rx = _mm_mul_ps(rx, invDet);
+		ry = _mm_mul_ps(ry, invDet);
+		rz = _mm_mul_ps(rz, invDet);
+		rw = _mm_mul_ps(rw, invDet);
+
+		return
+		{
+			vec_store(_mm_shuffle_ps(rx, ry, _MM_SHUFFLE(1, 3, 1, 3))),
+			vec_store(_mm_shuffle_ps(rx, ry, _MM_SHUFFLE(0, 2, 0, 2))),
+			vec_store(_mm_shuffle_ps(rz, rw, _MM_SHUFFLE(1, 3, 1, 3))),
+			vec_store(_mm_shuffle_ps(rz, rw, _MM_SHUFFLE(0, 2, 0, 2)))
+		};
+	}
+}
+
+inline __m128 vec_cross(__m128 a, __m128 b)
+{
+	const __m128 result = _mm_sub_ps(
+		_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1))),
+		_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)), b));
+	return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+constexpr mat4 mat_invert_affine(const mat4& m)
+{
+	if consteval { return mat_invert_affine<float>(m); }
+	else
+	{
+		__m128 x, y, z, w;
+		mat_load(m, x, y, z, w);
+
+		// The w lanes of the basis are zero in an affine transform, so the crosses' w lanes are too.
+		__m128 rx = vec_cross(y, z);
+		__m128 ry = vec_cross(z, x);
+		__m128 rz = vec_cross(x, y);
+		const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.f), vec_sum(_mm_mul_ps(x, rx)));
+
+		rx = _mm_mul_ps(rx, invDet);
+		ry = _mm_mul_ps(ry, invDet);
+		rz = _mm_mul_ps(rz, invDet);
+
+		// Translation is -M⁻¹t, taken from the rows before they are transposed into columns.
+		const __m128 t = _mm_sub_ps(_mm_setzero_ps(), _mm_movelh_ps(
+			_mm_unpacklo_ps(vec_sum(_mm_mul_ps(rx, w)), vec_sum(_mm_mul_ps(ry, w))),
+			_mm_unpacklo_ps(vec_sum(_mm_mul_ps(rz, w)), _mm_setzero_ps())));
+
+		__m128 rw = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+
+		return { vec_store(rx), vec_store(ry), vec_store(rz), vec_store(_mm_add_ps(t, _mm_setr_ps(0.f, 0.f, 0.f, 1.f))) };
+	}
+}
+
+#elif defined(SECRETEST_NEON)
+
+constexpr vec4 mat_multiply(const mat4& a, const vec4& b)
+{
+	if consteval { return mat_multiply<4, float>(a, b); }
+	else
+	{
+		const float32x4_t v = vec_load(b);
+		float32x4_t result = vmulq_laneq_f32(vec_load(a[0]), v, 0);
+		result = vfmaq_laneq_f32(result, vec_load(a[1]), v, 1);
+		result = vfmaq_laneq_f32(result, vec_load(a[2]), v, 2);
+		return vec_store(vfmaq_laneq_f32(result, vec_load(a[3]), v, 3));
+	}
+}
+
+constexpr mat4 mat_multiply(const mat4& a, const mat4& b)
+{
+	if consteval { return mat_multiply<4, float>(a, b); }
+	else { return { mat_multiply(a, b[0]), mat_multiply(a, b[1]), mat_multiply(a, b[2]), mat_multiply(a, b[3]) }; }
+}
+
+#endif
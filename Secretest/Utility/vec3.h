@@ -6,11 +6,12 @@ template<class T>
 struct vec<3, T>
 {
     constexpr vec() = default;
-    constexpr vec(T x_) : x(x_), y(x_), z(x_) {}
-    constexpr vec(T x_, T y_, T z_) : x(x_), y(y_), z(z_) {}
+    // Initializes v, the member operator[] reads, like vec4.
+    constexpr vec(T x_) : v{ x_, x_, x_ } {}
+    constexpr vec(T x_, T y_, T z_) : v{ x_, y_, z_ } {}
     constexpr vec(const vec&) = default;
 
-    constexpr vec operator-() const { return { -x, -y, -z }; }
+    constexpr vec operator-() const { return { -v[0], -v[1], -v[2] }; }
 
     template<size_t WIDTH, class NEW_T> requires (WIDTH <= 3)
     constexpr explicit operator vec<WIDTH, NEW_T>() const
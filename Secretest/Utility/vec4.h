@@ -2,28 +2,40 @@
 
 #include "Math.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#define SECRETEST_SSE 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define SECRETEST_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Aligned so the float version can be loaded straight into a register.
 template<class T>
-struct vec<4, T>
+struct alignas(4 * sizeof(T)) vec<4, T>
 {
+    // Everything initializes v rather than x/y/z/w so the active union member is the one operator[] reads,
+    // which keeps the type usable in constant expressions.
     constexpr vec() = default;
-    constexpr vec(T x_) : x(x_), y(x_), z(x_) {}
-    constexpr vec(T x_, T y_, T z_, T w_) : x(x_), y(y_), z(z_), w(w_) {}
-    constexpr vec(const vec<3, T>& vec, T w_) : x(vec[0]), y(vec[1]), z(vec[2]), w(w_) {}
-    constexpr vec(const vec<2, T>& lower, const vec<2, T>& upper) : x(lower[0]), y(lower[1]), z(upper[0]), w(upper[1]) {}
-    constexpr vec(const vec<2, T>& lower, T z_, T w_) : x(lower[0]), y(lower[1]), z(z_), w(w_) {}
+    constexpr vec(T x_) : v{ x_, x_, x_, x_ } {}
+    constexpr vec(T x_, T y_, T z_, T w_) : v{ x_, y_, z_, w_ } {}
+    constexpr vec(const vec<3, T>& vec, T w_) : v{ vec[0], vec[1], vec[2], w_ } {}
+    constexpr vec(const vec<2, T>& lower, const vec<2, T>& upper) : v{ lower[0], lower[1], upper[0], upper[1] } {}
+    constexpr vec(const vec<2, T>& lower, T z_, T w_) : v{ lower[0], lower[1], z_, w_ } {}
     constexpr vec(const vec&) = default;
+    constexpr vec& operator=(const vec&) = default;
 
-    constexpr vec operator-() const { return { -x, -y, -z, -w }; }
+    constexpr vec operator-() const { return { -v[0], -v[1], -v[2], -v[3] }; }
 
     constexpr bool operator==(const vec& b) const { return v == b.v; }
 
     template<size_t WIDTH, class NEW_T> requires (WIDTH <= 4)
-    constexpr explicit operator vec<WIDTH, NEW_T>() const 
+    constexpr explicit operator vec<WIDTH, NEW_T>() const
     {
-        vec<WIDTH, NEW_T> result; 
-        for (size_t i = 0; i < WIDTH; i++) 
-            result[i] = (NEW_T) v[i]; 
-        return result; 
+        vec<WIDTH, NEW_T> result;
+        for (size_t i = 0; i < WIDTH; i++)
+            result[i] = (NEW_T) v[i];
+        return result;
     }
 
     constexpr T& operator[](size_t i) { return v[i]; }
@@ -43,4 +55,94 @@ struct vec<4, T>
     };
 };
 
-using vec4 = vec<4, float>;
\ No newline at end of file
+using vec4 = vec<4, float>;
+
+// Float specializations. Plain overloads win over the generic templates; constant evaluation falls back to them.
+#if defined(SECRETEST_SSE)
+
+inline __m128 vec_load(const vec4& a) { return _mm_load_ps(a.v.data()); }
+inline vec4 vec_store(__m128 a)
+{
+    vec4 result;
+    _mm_store_ps(result.v.data(), a);
+    return result;
+}
+
+#define VEC4_SIMD_OP(OP, INTRINSIC) \
+    constexpr vec4 operator OP(const vec4& a, const vec4& b) \
+    { \
+        if consteval { return operator OP<4, float>(a, b); } \
+        else { return vec_store(INTRINSIC(vec_load(a), vec_load(b))); } \
+    } \
+    constexpr vec4 operator OP(const vec4& a, float b) \
+    { \
+        if consteval { return operator OP<4, float>(a, b); } \
+        else { return vec_store(INTRINSIC(vec_load(a), _mm_set1_ps(b))); } \
+    } \
+    constexpr vec4 operator OP(float a, const vec4& b) \
+    { \
+        if consteval { return operator OP<4, float>(a, b); } \
+        else { return vec_store(INTRINSIC(_mm_set1_ps(a), vec_load(b))); } \
+    } \
+    constexpr vec4& operator OP##=(vec4& a, const vec4& b) { return a = a OP b; } \
+    constexpr vec4& operator OP##=(vec4& a, float b) { return a = a OP b; }
+
+VEC4_SIMD_OP(-, _mm_sub_ps);
+VEC4_SIMD_OP(+, _mm_add_ps);
+VEC4_SIMD_OP(*, _mm_mul_ps);
+VEC4_SIMD_OP(/, _mm_div_ps);
+
+// Horizontal sum into every lane, SSE2 only.
+inline __m128 vec_sum(__m128 a)
+{
+    a = _mm_add_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+constexpr float vec_dot(const vec4& a, const vec4& b)
+{
+    if consteval { return vec_dot<4, float>(a, b); }
+    else { return _mm_cvtss_f32(vec_sum(_mm_mul_ps(vec_load(a), vec_load(b)))); }
+}
+
+#elif defined(SECRETEST_NEON)
+
+inline float32x4_t vec_load(const vec4& a) { return vld1q_f32(a.v.data()); }
+inline vec4 vec_store(float32x4_t a)
+{
+    vec4 result;
+    vst1q_f32(result.v.data(), a);
+    return result;
+}
+
+#define VEC4_SIMD_OP(OP, INTRINSIC) \
+    constexpr vec4 operator OP(const vec4& a, const vec4& b) \
+    { \
+        if consteval { return operator OP<4, float>(a, b); } \
+        else { return vec_store(INTRINSIC(vec_load(a), vec_load(b))); } \
+    } \
+    constexpr vec4 operator OP(const vec4& a, float b) \
+    { \
+        if consteval { return operator OP<4, float>(a, b); } \
+        else { return vec_store(INTRINSIC(vec_load(a), vdupq_n_f32(b))); } \
+    } \
+    constexpr vec4 operator OP(float a, const vec4& b) \
+    { \
+        if consteval { return operator OP<4, float>(a, b); } \
+        else { return vec_store(INTRINSIC(vdupq_n_f32(a), vec_load(b))); } \
+    } \
+    constexpr vec4& operator OP##=(vec4& a, const vec4& b) { return a = a OP b; } \
+    constexpr vec4& operator OP##=(vec4& a, float b) { return a = a OP b; }
+
+VEC4_SIMD_OP(-, vsubq_f32);
+VEC4_SIMD_OP(+, vaddq_f32);
+VEC4_SIMD_OP(*, vmulq_f32);
+VEC4_SIMD_OP(/, vdivq_f32);
+
+constexpr float vec_dot(const vec4& a, const vec4& b)
+{
+    if consteval { return vec_dot<4, float>(a, b); }
+    else { return vaddvq_f32(vmulq_f32(vec_load(a), vec_load(b))); }
+}
+
+#endif
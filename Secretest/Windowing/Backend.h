@@ -0,0 +1,43 @@
+//
+// Created by scion on 1/23/2026.
+//
+
+#pragma once
+
+#include "Window.h"
+
+namespace Secretest
+{
+    // Everything the widget layer needs from a platform. Handles are opaque to the widgets;
+    // each backend decides what an HWND points to.
+    class IWindowBackend
+    {
+    public:
+        virtual ~IWindowBackend() = default;
+
+        // transform is already normalized against the parent.
+        virtual HWND CreateNativeWindow(IWindow& window, const IWindowType& type, std::string_view text, const WindowTransform& transform, HWND parent) = 0;
+        virtual void DestroyNativeWindow(HWND hwnd) = 0;
+        // The IWindow owning hwnd was moved.
+        virtual void BindNativeWindow(HWND hwnd, IWindow& window) = 0;
+
+        virtual void SetText(HWND hwnd, std::string_view text) = 0;
+        [[nodiscard]] virtual std::string GetText(HWND hwnd) const = 0;
+        virtual void SetRect(HWND hwnd, const WindowTransform& transform) = 0;
+
+        virtual void Invalidate(HWND hwnd) = 0;
+        virtual void PaintBackground(HWND hwnd) = 0;
+
+        // Pumps input and drains IWindow's task queue until the last Normal window is closed.
+        virtual void Run() = 0;
+
+    protected:
+        static void Paint(IWindow& window) { window.OnPaint(); }
+        static void Command(IWindow& window) { window.OnCommand(); }
+        static void Resize(Window& window, uvec2 size) { window.OnResize(size); }
+        static void Scroll(Window& window, int32_t delta) { window.OnScroll(delta); }
+        [[nodiscard]] static HWND GetHWND(const IWindow& window) { return window.GetHWND(); }
+        [[nodiscard]] static bool IsOpen(const IWindow& window) { return window.IsOpen(); }
+        [[nodiscard]] static TaskQueue& GetTasks() { return IWindow::Tasks; }
+    };
+}
@@ -0,0 +1,219 @@
+//
+// Created by scion on 1/23/2026.
+//
+
+#include "HeadlessBackend.h"
+
+#include <algorithm>
+
+namespace Secretest
+{
+    HWND HeadlessBackend::CreateNativeWindow(IWindow& window, const IWindowType& type, std::string_view text, const WindowTransform& transform, HWND parent)
+    {
+        Node* parentNode = GetNode(parent);
+
+        Node* node = new Node{ &window, parentNode, {}, std::string(type.Class), std::string(text), transform };
+        if(parentNode)
+            parentNode->Children.push_back(node);
+
+        _nodes.insert(node);
+        _statistics.Created++;
+
+        return reinterpret_cast<HWND>(node);
+    }
+
+    void HeadlessBackend::DestroyNativeWindow(HWND hwnd)
+    {
+        // Destroying a parent already took the children with it, same as Win32.
+        Node* node = GetNode(hwnd);
+        if(!node)
+            return;
+
+        if(node->Parent)
+            std::erase(node->Parent->Children, node);
+
+        // Closing a normal top level window ends the loop, popups don't.
+        if(node->Class == "Window")
+            Quit();
+
+        Destroy(node);
+    }
+
+    void HeadlessBackend::Destroy(Node* node)
+    {
+        for(Node* child : node->Children)
+            Destroy(child);
+
+        std::erase(_invalid, node);
+        _nodes.erase(node);
+        _statistics.Destroyed++;
+
+        delete node;
+    }
+
+    void HeadlessBackend::BindNativeWindow(HWND hwnd, IWindow& window)
+    {
+        if(Node* node = GetNode(hwnd))
+            node->Window = &window;
+    }
+
+    void HeadlessBackend::SetText(HWND hwnd, std::string_view text)
+    {
+        if(Node* node = GetNode(hwnd))
+        {
+            node->Text = text;
+            _statistics.TextUpdates++;
+        }
+    }
+
+    std::string HeadlessBackend::GetText(HWND hwnd) const
+    {
+        const Node* node = GetNode(hwnd);
+        return node ? node->Text : std::string();
+    }
+
+    void HeadlessBackend::SetRect(HWND hwnd, const WindowTransform& transform)
+    {
+        if(Node* node = GetNode(hwnd))
+        {
+            node->Rect = transform;
+            _statistics.RectUpdates++;
+        }
+    }
+
+    void HeadlessBackend::Invalidate(HWND hwnd)
+    {
+        _statistics.Invalidations++;
+
+        // Anything invalidated while painting is covered by the paint in progress.
+        Node* node = GetNode(hwnd);
+        if(!node || _isPainting || node->IsInvalid)
+            return;
+
+        node->IsInvalid = true;
+        _invalid.push_back(node);
+    }
+
+    bool HeadlessBackend::PumpOnce()
+    {
+        const bool hasTasks = GetTasks().HasTasks();
+        GetTasks().RunAllTasks();
+
+        if(_invalid.empty())
+            return hasTasks;
+
+        // Only the classes our window procedure is registered for get painted; the stock controls paint themselves.
+        std::vector<Node*> invalid = std::move(_invalid);
+        _invalid.clear();
+
+        _isPainting = true;
+        for(size_t i = 0; i < invalid.size(); i++)
+        {
+            // A paint may destroy windows further down the list.
+            Node* node = invalid[i];
+            if(!_nodes.contains(node))
+                continue;
+
+            node->IsInvalid = false;
+            if(node->Class != "Window" && node->Class != "Popup")
+                continue;
+
+            _statistics.Paints++;
+            if(IsOpen(*node->Window))
+                Paint(*node->Window);
+        }
+        _isPainting = false;
+
+        return true;
+    }
+
+    void HeadlessBackend::Run()
+    {
+        GetTasks().SetWakeHandler([this] { Wake(); });
+
+        _isRunning = true;
+        while(_isRunning)
+        {
+            if(PumpOnce())
+                continue;
+
+            // A wake between the pump and here is remembered, not lost.
+            std::unique_lock lock(_wakeMutex);
+            _wakeCondition.wait(lock, [this] { return _isWoken || !_isRunning; });
+            _isWoken = false;
+        }
+
+        GetTasks().SetWakeHandler(nullptr);
+    }
+
+    void HeadlessBackend::Quit()
+    {
+        _isRunning = false;
+        Wake();
+    }
+
+    void HeadlessBackend::Wake()
+    {
+        {
+            std::unique_lock lock(_wakeMutex);
+            _isWoken = true;
+        }
+
+        _wakeCondition.notify_one();
+    }
+
+    void HeadlessBackend::SimulateResize(Window& window, uvec2 size)
+    {
+        Node* node = GetNode(window);
+        if(!node)
+            return;
+
+        node->Rect.Size = vec2(size);
+        Resize(window, size);
+    }
+
+    void HeadlessBackend::SimulateScroll(Window& window, int32_t delta)
+    {
+        if(GetNode(window))
+            Scroll(window, delta);
+    }
+
+    void HeadlessBackend::SimulateClick(IWindow& window)
+    {
+        if(GetNode(window))
+            Command(window);
+    }
+
+    void HeadlessBackend::SimulateTyping(TextField& field, std::string_view text)
+    {
+        Node* node = GetNode(field);
+        if(!node)
+            return;
+
+        node->Text += text;
+        Command(field);
+    }
+
+    size_t HeadlessBackend::GetChildCount(const IWindow& window) const
+    {
+        const Node* node = GetNode(window);
+        return node ? node->Children.size() : 0;
+    }
+
+    WindowTransform HeadlessBackend::GetRect(const IWindow& window) const
+    {
+        const Node* node = GetNode(window);
+        return node ? node->Rect : WindowTransform{};
+    }
+
+    HeadlessBackend::Node* HeadlessBackend::GetNode(HWND hwnd) const
+    {
+        Node* node = reinterpret_cast<Node*>(hwnd);
+        return _nodes.contains(node) ? node : nullptr;
+    }
+
+    HeadlessBackend::Node* HeadlessBackend::GetNode(const IWindow& window) const
+    {
+        return GetNode(GetHWND(window));
+    }
+}
@@ -0,0 +1,95 @@
+//
+// Created by scion on 1/23/2026.
+//
+
+#pragma once
+
+#include "Backend.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace Secretest
+{
+    struct HeadlessStatistics
+    {
+        uint64_t Created = 0;
+        uint64_t Destroyed = 0;
+        uint64_t RectUpdates = 0;
+        uint64_t TextUpdates = 0;
+        uint64_t Invalidations = 0;
+        uint64_t Paints = 0;
+    };
+
+    // Keeps the widget tree in memory and never touches a display. Input is simulated, painting
+    // only counts. Not thread safe, same as the Win32 one: only the UI thread may touch windows.
+    class HeadlessBackend final : public IWindowBackend
+    {
+    public:
+        HWND CreateNativeWindow(IWindow& window, const IWindowType& type, std::string_view text, const WindowTransform& transform, HWND parent) override;
+        void DestroyNativeWindow(HWND hwnd) override;
+        void BindNativeWindow(HWND hwnd, IWindow& window) override;
+
+        void SetText(HWND hwnd, std::string_view text) override;
+        [[nodiscard]] std::string GetText(HWND hwnd) const override;
+        void SetRect(HWND hwnd, const WindowTransform& transform) override;
+
+        void Invalidate(HWND hwnd) override;
+        void PaintBackground(HWND) override {};
+
+        // Sleeps until a task is queued or Quit is called.
+        void Run() override;
+        // Drains the task queue and paints whatever was invalidated, once. Returns false if there was nothing to do.
+        bool PumpOnce();
+        // Safe from any thread.
+        void Quit();
+        // The UI thread's queue, for whatever is standing in for the network thread.
+        using IWindowBackend::GetTasks;
+
+        // Simulated input, delivered synchronously the way the window procedure would.
+        void SimulateResize(Window& window, uvec2 size);
+        void SimulateScroll(Window& window, int32_t delta);
+        void SimulateClick(IWindow& window);
+        void SimulateTyping(TextField& field, std::string_view text);
+
+        [[nodiscard]] const HeadlessStatistics& GetStatistics() const { return _statistics; }
+        void ResetStatistics() { _statistics = {}; }
+
+        [[nodiscard]] size_t GetWindowCount() const { return _nodes.size(); }
+        [[nodiscard]] size_t GetChildCount(const IWindow& window) const;
+        [[nodiscard]] WindowTransform GetRect(const IWindow& window) const;
+
+    private:
+        struct Node
+        {
+            IWindow* Window;
+            Node* Parent;
+            std::vector<Node*> Children;
+            std::string Class;
+            std::string Text;
+            WindowTransform Rect;
+            bool IsInvalid = false;
+        };
+
+        [[nodiscard]] Node* GetNode(HWND hwnd) const;
+        [[nodiscard]] Node* GetNode(const IWindow& window) const;
+        void Destroy(Node* node);
+        void Wake();
+
+        std::unordered_set<Node*> _nodes;
+        std::vector<Node*> _invalid;
+        bool _isPainting = false;
+
+        std::atomic<bool> _isRunning = false;
+        std::mutex _wakeMutex;
+        std::condition_variable _wakeCondition;
+        bool _isWoken = false;
+
+        HeadlessStatistics _statistics;
+    };
+}
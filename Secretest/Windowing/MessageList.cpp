@@ -0,0 +1,113 @@
+//
+// Created by scion on 1/24/2026.
+//
+
+#include "MessageList.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Secretest
+{
+    MessageList::MessageList(const WindowTransform& transform, const IWindow& window, MessageListOptions options) :
+        IWindow(IWindowType{ "Static", 0 }, "", transform, &window),
+        _options(options),
+        _messages(options.HistoryCapacity)
+    {
+        UpdateRowCount();
+    }
+
+    void MessageList::Push(std::string_view message)
+    {
+        _messages.Push(message);
+
+        // Scrolled up and the top row fell out of the history.
+        _first = std::max(_first, _messages.GetBegin());
+
+        Bind();
+    }
+
+    void MessageList::Push(std::span<const std::string> messages)
+    {
+        for(const std::string& message : messages)
+            _messages.Push(message);
+
+        _first = std::max(_first, _messages.GetBegin());
+
+        Bind();
+    }
+
+    void MessageList::Scroll(int64_t rows)
+    {
+        const uint64_t last = GetLastFirst();
+        _first = std::clamp<int64_t>(static_cast<int64_t>(_first) + rows, _messages.GetBegin(), last);
+        _isFollowing = _first == last;
+
+        Bind();
+    }
+
+    void MessageList::ScrollToEnd()
+    {
+        _isFollowing = true;
+        Bind();
+    }
+
+    void MessageList::OnLayout()
+    {
+        UpdateRowCount();
+    }
+
+    void MessageList::UpdateRowCount()
+    {
+        const float height = GetGlobalTransform().Size.y;
+        const size_t rowCount = std::max<size_t>(1, std::ceil(height / _options.RowHeight));
+
+        if(rowCount == _rows.size())
+            return;
+
+        while(_rows.size() > rowCount)
+        {
+            _rows.pop_back();
+            _bound.pop_back();
+        }
+
+        while(_rows.size() < rowCount)
+        {
+            const WindowTransform transform
+            {
+                vec2(0, _rows.size() * _options.RowHeight),
+                vec2(1, _options.RowHeight),
+                vec<2, TransformMode>(TransformMode::Absolute),
+                vec<2, TransformMode>(TransformMode::Relative, TransformMode::Absolute)
+            };
+
+            _rows.emplace_back("", transform, *this);
+            _bound.push_back(UINT64_MAX);
+        }
+
+        Bind();
+    }
+
+    uint64_t MessageList::GetLastFirst() const
+    {
+        return std::max(_messages.GetBegin(), _messages.GetEnd() - std::min<uint64_t>(_messages.GetEnd(), _rows.size()));
+    }
+
+    void MessageList::Bind()
+    {
+        if(_isFollowing)
+            _first = GetLastFirst();
+
+        for(size_t i = 0; i < _rows.size(); i++)
+        {
+            const uint64_t index = _first + i;
+            const uint64_t bound = _messages.Contains(index) ? index : UINT64_MAX;
+
+            if(_bound[i] == bound)
+                continue;
+
+            _bound[i] = bound;
+            _rows[i].SetText(bound == UINT64_MAX ? std::string_view() : _messages[index]);
+        }
+    }
+}
@@ -0,0 +1,118 @@
+//
+// Created by scion on 1/24/2026.
+//
+
+#pragma once
+
+#include "Window.h"
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Secretest
+{
+    // Bounded history of text messages packed into one buffer. Indices are absolute and keep
+    // counting up; once a message falls out of the history its index is gone for good.
+    class MessageStore
+    {
+    public:
+        explicit MessageStore(size_t capacity = 10000) : _capacity(capacity) {}
+
+        void Push(std::string_view message)
+        {
+            if(_capacity && Size() >= _capacity)
+                PopFront();
+
+            _offsets.push_back(_text.size() + _base);
+            _text.insert(_text.end(), message.begin(), message.end());
+            _end++;
+        }
+
+        [[nodiscard]] std::string_view operator[](uint64_t index) const
+        {
+            const size_t i = index - GetBegin();
+            const size_t start = _offsets[i] - _base;
+            const size_t end = (i + 1 < _offsets.size() ? _offsets[i + 1] : _text.size() + _base) - _base;
+            return { _text.data() + start, end - start };
+        }
+
+        [[nodiscard]] bool Contains(uint64_t index) const { return index >= GetBegin() && index < _end; }
+
+        [[nodiscard]] uint64_t GetBegin() const { return _end - _offsets.size(); }
+        [[nodiscard]] uint64_t GetEnd() const { return _end; }
+        [[nodiscard]] size_t Size() const { return _offsets.size(); }
+        [[nodiscard]] size_t GetCapacity() const { return _capacity; }
+        [[nodiscard]] size_t GetByteSize() const { return _text.size(); }
+
+    private:
+        void PopFront()
+        {
+            _offsets.pop_front();
+
+            // Text is only compacted once most of the buffer is dead, keeping eviction amortized O(1).
+            const size_t dead = (_offsets.empty() ? _text.size() + _base : _offsets.front()) - _base;
+            if(dead * 2 < _text.size())
+                return;
+
+            _text.erase(_text.begin(), _text.begin() + dead);
+            _base += dead;
+        }
+
+        // Offsets are relative to _base, the number of bytes ever compacted away, so they never need rewriting.
+        std::vector<char> _text;
+        std::deque<size_t> _offsets;
+        size_t _base = 0;
+        uint64_t _end = 0;
+        size_t _capacity;
+    };
+
+    struct MessageListOptions
+    {
+        float RowHeight = 32;
+        // Zero keeps everything.
+        size_t HistoryCapacity = 10000;
+    };
+
+    // Only the rows on screen get a Label; scrolling rebinds their text instead of moving windows around.
+    class MessageList final : public IWindow
+    {
+    public:
+        MessageList(const WindowTransform& transform, const IWindow& window, MessageListOptions options = {});
+
+        void Push(std::string_view message);
+        // Rows are only rebound once for the whole batch.
+        void Push(std::span<const std::string> messages);
+
+        // Positive scrolls towards newer messages. Scrolling back to the end follows new messages again.
+        void Scroll(int64_t rows);
+        void ScrollToEnd();
+
+        [[nodiscard]] const MessageStore& GetMessages() const { return _messages; }
+        [[nodiscard]] uint64_t GetFirstVisible() const { return _first; }
+        [[nodiscard]] size_t GetRowCount() const { return _rows.size(); }
+
+    protected:
+        void OnCommand() override {};
+        void OnLayout() override;
+
+    private:
+        void UpdateRowCount();
+        void Bind();
+        // The first visible message when scrolled all the way down.
+        [[nodiscard]] uint64_t GetLastFirst() const;
+
+        MessageListOptions _options;
+        MessageStore _messages;
+
+        std::deque<Label> _rows;
+        // Which message each row currently shows, so unchanged rows aren't touched.
+        std::vector<uint64_t> _bound;
+
+        uint64_t _first = 0;
+        bool _isFollowing = true;
+    };
+}
@@ -4,12 +4,15 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <iterator>
 #include <list>
 #include <utility>
 #include <memory>
 #include <mutex>
 #include <print>
+#include <vector>
 
 namespace Secretest
 {
@@ -46,6 +49,7 @@ namespace Secretest
         {
             std::unique_lock lock(_mutex);
             _queue.push_back(std::forward<TASK_T>(task));
+            OnPush();
         }
 
         template<typename FUNC_T, typename... ARGS>
@@ -53,16 +57,28 @@ namespace Secretest
         {
             std::unique_lock lock(_mutex);
             _queue.push_back(std::make_unique<Task<FUNC_T, ARGS...>>(std::forward<FUNC_T>(func), std::forward<ARGS>(args)...));
+            OnPush();
         }
 
-        void RunAllTasks()
+        // Called from whichever thread pushes into an empty queue, with the queue locked, so it must not block
+        // or push. The consumer is expected to drain the queue before waiting again.
+        void SetWakeHandler(std::function<void()> handler)
         {
             std::unique_lock lock(_mutex);
+            _wakeHandler = std::move(handler);
+        }
 
-            for(const auto& item : _queue)
-                item->operator()();
+        // Tasks queued while running are left for the next call.
+        void RunAllTasks()
+        {
+            std::list<std::unique_ptr<ITask>> queue;
+            {
+                std::unique_lock lock(_mutex);
+                queue.swap(_queue);
+            }
 
-            _queue.clear();
+            for(const auto& item : queue)
+                item->operator()();
         }
 
         [[nodiscard]] bool HasTasks()
@@ -72,7 +88,54 @@ namespace Secretest
         }
 
     private:
+        void OnPush() const
+        {
+            // Only the first task since the last drain wakes anyone.
+            if(_wakeHandler && _queue.size() == 1)
+                _wakeHandler();
+        }
+
         std::mutex _mutex;
         std::list<std::unique_ptr<ITask>> _queue;
+        std::function<void()> _wakeHandler;
+    };
+
+    // Many producers, one consumer. Only the first push since the consumer last took everything
+    // asks for a flush, so a burst costs the consumer one task instead of one per item.
+    template<typename T>
+    class Inbox
+    {
+    public:
+        // True if the caller should schedule a flush.
+        [[nodiscard]] bool Push(T value)
+        {
+            {
+                std::unique_lock lock(_mutex);
+                _items.push_back(std::move(value));
+            }
+
+            return !_isFlushPending.exchange(true);
+        }
+
+        // Appends everything pushed so far to items.
+        void Take(std::vector<T>& items)
+        {
+            _isFlushPending = false;
+
+            std::unique_lock lock(_mutex);
+            if(items.empty())
+                items.swap(_items);
+            else
+                std::move(_items.begin(), _items.end(), std::back_inserter(items));
+            _items.clear();
+        }
+
+        // For a consumer that ran out of time with items left over. True if the caller should schedule a flush.
+        [[nodiscard]] bool Reschedule() { return !_isFlushPending.exchange(true); }
+
+    private:
+        std::mutex _mutex;
+        std::vector<T> _items;
+        std::atomic<bool> _isFlushPending = false;
     };
 }
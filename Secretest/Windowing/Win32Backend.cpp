@@ -0,0 +1,196 @@
+//
+// Created by scion on 1/23/2026.
+//
+
+#include "Win32Backend.h"
+
+#include <windows.h>
+#include <winuser.h>
+
+#define TEXT_FIELD_FLAGS WS_BORDER | ES_LEFT | ES_AUTOHSCROLL | ES_MULTILINE
+// Posted to the task window when a task is queued.
+#define WM_RUN_TASKS (WM_APP + 1)
+
+namespace Secretest
+{
+    Win32Backend::Win32Backend()
+    {
+        RegisterStyle(IWindowClass{ "Window", WindowProc });
+        RegisterStyle(IWindowClass{ "Popup", WindowProcNoQuit });
+        RegisterStyle(IWindowClass{ "Tasks", TaskProc });
+    }
+
+    HWND Win32Backend::CreateNativeWindow(IWindow& window, const IWindowType& type, std::string_view text, const WindowTransform& transform, HWND parent)
+    {
+        HINSTANCE hInstance = GetModuleHandle(nullptr);
+
+        DWORD style = WS_VISIBLE | type.Flags;
+        if(parent) style |= WS_CHILD;
+        if(type.Class == "Edit") style |= TEXT_FIELD_FLAGS;
+
+        HWND hwnd = CreateWindowEx(
+            0,
+            type.Class.data(),
+            text.data(),
+            style,
+            static_cast<int>(transform.Position.x),
+            static_cast<int>(transform.Position.y),
+            static_cast<int>(transform.Size.x),
+            static_cast<int>(transform.Size.y),
+            parent,
+            nullptr,
+            hInstance,
+            &window
+        );
+
+        SetWindowLongPtr(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(&window));
+
+        return hwnd;
+    }
+
+    void Win32Backend::DestroyNativeWindow(HWND hwnd)
+    {
+        DestroyWindow(hwnd);
+    }
+
+    void Win32Backend::BindNativeWindow(HWND hwnd, IWindow& window)
+    {
+        SetWindowLongPtr(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(&window));
+    }
+
+    void Win32Backend::SetText(HWND hwnd, std::string_view text)
+    {
+        // SetWindowTextA wants it terminated.
+        SetWindowTextA(hwnd, std::string(text).c_str());
+    }
+
+    std::string Win32Backend::GetText(HWND hwnd) const
+    {
+        const int length = GetWindowTextLengthA(hwnd);
+        std::string text(length, '\0');
+        GetWindowTextA(hwnd, text.data(), length + 1);
+        return text;
+    }
+
+    void Win32Backend::SetRect(HWND hwnd, const WindowTransform& transform)
+    {
+        SetWindowPos(
+            hwnd,
+            nullptr,
+            static_cast<int>(transform.Position.x),
+            static_cast<int>(transform.Position.y),
+            static_cast<int>(transform.Size.x),
+            static_cast<int>(transform.Size.y),
+            0
+        );
+    }
+
+    void Win32Backend::Invalidate(HWND hwnd)
+    {
+        RedrawWindow(hwnd, nullptr, nullptr, RDW_ERASE | RDW_INVALIDATE | RDW_FRAME | RDW_ALLCHILDREN);
+    }
+
+    void Win32Backend::PaintBackground(HWND hwnd)
+    {
+        PAINTSTRUCT ps;
+        HDC hdc = BeginPaint(hwnd, &ps);
+
+        FillRect(hdc, &ps.rcPaint, reinterpret_cast<HBRUSH>(COLOR_WINDOW));
+
+        EndPaint(hwnd, &ps);
+    }
+
+    void Win32Backend::Run()
+    {
+        // Thread messages are lost while a modal loop runs, one posted to a window is dispatched by it.
+        HWND tasks = CreateWindowExA(0, "Tasks", nullptr, 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, GetModuleHandle(nullptr), nullptr);
+        GetTasks().SetWakeHandler([tasks]
+        {
+            PostMessageA(tasks, WM_RUN_TASKS, 0, 0);
+        });
+
+        // Anything queued before the handler was set didn't post.
+        GetTasks().RunAllTasks();
+
+        MSG msg{};
+        while (GetMessageA(&msg, nullptr, 0, 0))
+        {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+
+        GetTasks().SetWakeHandler(nullptr);
+        DestroyWindow(tasks);
+    }
+
+    LRESULT Win32Backend::WindowProc(HWND hwnd, UINT uMSG, WPARAM wParam, LPARAM lParam)
+    {
+        Window* window = reinterpret_cast<Window*>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
+
+        if(window && IsOpen(*window))
+            ProcessInput(*window, uMSG, wParam, lParam);
+
+        return DefWindowProcA(hwnd, uMSG, wParam, lParam);
+    }
+
+    LRESULT Win32Backend::TaskProc(HWND hwnd, UINT uMSG, WPARAM wParam, LPARAM lParam)
+    {
+        if(uMSG != WM_RUN_TASKS)
+            return DefWindowProcA(hwnd, uMSG, wParam, lParam);
+
+        GetTasks().RunAllTasks();
+        return 0;
+    }
+
+    LRESULT Win32Backend::WindowProcNoQuit(HWND hwnd, UINT uMSG, WPARAM wParam, LPARAM lParam)
+    {
+        if(uMSG == WM_DESTROY)
+            return 1;
+
+        return WindowProc(hwnd, uMSG, wParam, lParam);
+    }
+
+    void Win32Backend::RegisterStyle(const IWindowClass& windowClass)
+    {
+        HINSTANCE hInstance = GetModuleHandle(nullptr);
+
+        WNDCLASS wndclass{};
+        wndclass.lpszClassName = windowClass.Name.data();
+        wndclass.hInstance = hInstance;
+        wndclass.lpfnWndProc = windowClass.WindowProc;
+
+        RegisterClass(&wndclass);
+    }
+
+    void Win32Backend::ProcessInput(Window& window, UINT message, WPARAM wParam, LPARAM param)
+    {
+        IWindow* child = reinterpret_cast<IWindow*>(GetWindowLongPtr(reinterpret_cast<HWND>(param), GWLP_USERDATA));
+        LPMINMAXINFO minMaxInfo = reinterpret_cast<LPMINMAXINFO>(param);
+
+        switch(message)
+        {
+        case WM_DESTROY:
+            PostQuitMessage(0);
+            break;
+        case WM_SIZE:
+            Resize(window, uvec2(LOWORD(param), HIWORD(param)));
+            break;
+        case WM_PAINT:
+            Paint(window);
+            break;
+        case WM_MOUSEWHEEL:
+            Scroll(window, GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA);
+            break;
+        case WM_COMMAND:
+            if(child)
+                Command(*child);
+            break;
+        case WM_GETMINMAXINFO:
+            minMaxInfo->ptMinTrackSize = POINT(window.GetMinSize().x, window.GetMinSize().y);
+            minMaxInfo->ptMaxTrackSize = POINT(window.GetMaxSize().x, window.GetMaxSize().y);
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+//
+// Created by scion on 1/23/2026.
+//
+
+#pragma once
+
+#include "Backend.h"
+
+#include <minwindef.h>
+
+namespace Secretest
+{
+    using WindowProc = LRESULT(*)(HWND, UINT, WPARAM, LPARAM);
+    struct IWindowClass
+    {
+        std::string_view Name;
+        WindowProc WindowProc;
+    };
+
+    class Win32Backend final : public IWindowBackend
+    {
+    public:
+        Win32Backend();
+
+        HWND CreateNativeWindow(IWindow& window, const IWindowType& type, std::string_view text, const WindowTransform& transform, HWND parent) override;
+        void DestroyNativeWindow(HWND hwnd) override;
+        void BindNativeWindow(HWND hwnd, IWindow& window) override;
+
+        void SetText(HWND hwnd, std::string_view text) override;
+        [[nodiscard]] std::string GetText(HWND hwnd) const override;
+        void SetRect(HWND hwnd, const WindowTransform& transform) override;
+
+        void Invalidate(HWND hwnd) override;
+        void PaintBackground(HWND hwnd) override;
+
+        void Run() override;
+
+        static void RegisterStyle(const IWindowClass& windowClass);
+
+    private:
+        static LRESULT WindowProc(HWND, UINT, WPARAM, LPARAM);
+        static LRESULT WindowProcNoQuit(HWND hwnd, UINT uMSG, WPARAM wParam, LPARAM lParam);
+        // Message-only window the task queue wakes.
+        static LRESULT TaskProc(HWND hwnd, UINT uMSG, WPARAM wParam, LPARAM lParam);
+        static void ProcessInput(Window& window, UINT message, WPARAM wParam, LPARAM param);
+    };
+}
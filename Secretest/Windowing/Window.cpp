@@ -3,12 +3,16 @@
 //
 
 #include "Window.h"
+#include "Backend.h"
 
-#include <windows.h>
-#include <winuser.h>
-#include <unordered_map>
+#include <algorithm>
+#include <utility>
 
-#define TEXT_FIELD_FLAGS WS_BORDER | ES_LEFT | ES_AUTOHSCROLL | ES_MULTILINE
+#ifdef _WIN32
+#include "Win32Backend.h"
+#else
+#include "HeadlessBackend.h"
+#endif
 
 namespace Secretest
 {
@@ -30,53 +34,42 @@ namespace Secretest
         return result;
     }
 
+    IWindowBackend* IWindow::_backend = nullptr;
+
+    IWindowBackend& IWindow::GetBackend()
+    {
+        if(!_backend)
+        {
+#ifdef _WIN32
+            static Win32Backend backend;
+#else
+            static HeadlessBackend backend;
+#endif
+            _backend = &backend;
+        }
+
+        return *_backend;
+    }
+
     IWindow::IWindow(IWindowType windowStyle, std::string_view text, const WindowTransform& transform, const IWindow* parent) :
         _parent(parent),
         _transform(transform)
     {
-        Window::RegisterDefaultStyles();
-
-        HINSTANCE hInstance = GetModuleHandle(nullptr);
-
-        DWORD style = WS_VISIBLE | windowStyle.Flags;
-        if(_parent) style |= WS_CHILD;
-
-        const WindowTransform globalTransform = GetGlobalTransform();
-        _hwnd = CreateWindowEx(
-            0,
-            windowStyle.Class.data(),
-            text.data(),
-            style,
-            static_cast<int>(globalTransform.Position.x),
-            static_cast<int>(globalTransform.Position.y),
-            static_cast<int>(globalTransform.Size.x),
-            static_cast<int>(globalTransform.Size.y),
-            _parent ? _parent->_hwnd : nullptr,
-            nullptr,
-            hInstance,
-            this
-        );
-
-        SetWindowLongPtr(_hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+        _globalTransform = Normalize();
+        _hwnd = GetBackend().CreateNativeWindow(*this, windowStyle, text, _globalTransform, _parent ? _parent->_hwnd : nullptr);
+
+        if(_parent)
+            _parent->_children.push_back(this);
     }
 
     IWindow::~IWindow()
     {
-        _isOpen = false;
-        DestroyWindow(_hwnd);
-        _hwnd = nullptr;
+        Release();
     }
 
     IWindow::IWindow(IWindow&& b) noexcept
     {
-        _hwnd = b._hwnd;
-        b._hwnd = nullptr;
-
-        _transform = b._transform;
-        _parent = b._parent;
-        _isOpen = b._isOpen;
-
-        SetWindowLongPtr(_hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+        TakeOver(b);
     }
 
     IWindow& IWindow::operator=(IWindow&& b) noexcept
@@ -84,29 +77,59 @@ namespace Secretest
         if(&b == this)
             return *this;
 
-        this->~IWindow();
+        Release();
+        TakeOver(b);
 
-        _hwnd = b._hwnd;
-        b._hwnd = nullptr;
+        return *this;
+    }
+
+    void IWindow::Release()
+    {
+        _isOpen = false;
+        if(_hwnd)
+            GetBackend().DestroyNativeWindow(_hwnd);
+        _hwnd = nullptr;
+
+        if(_parent)
+            std::erase(_parent->_children, this);
+        _parent = nullptr;
+
+        // The native children went with ours.
+        for(IWindow* child : _children)
+            child->_parent = nullptr;
+        _children.clear();
+    }
+
+    void IWindow::TakeOver(IWindow& b)
+    {
+        _hwnd = std::exchange(b._hwnd, nullptr);
 
         _transform = b._transform;
-        _parent = b._parent;
+        _globalTransform = b._globalTransform;
+        _parent = std::exchange(b._parent, nullptr);
         _isOpen = b._isOpen;
 
-        SetWindowLongPtr(_hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+        if(_parent)
+            std::ranges::replace(_parent->_children, &b, this);
 
-        return *this;
+        _children = std::move(b._children);
+        b._children.clear();
+        for(IWindow* child : _children)
+            child->_parent = this;
+
+        if(_hwnd)
+            GetBackend().BindNativeWindow(_hwnd, *this);
     }
 
     void IWindow::RepaintAll() const
     {
-        RedrawWindow(GetHWND(), nullptr, nullptr, RDW_ERASE | RDW_INVALIDATE | RDW_FRAME | RDW_ALLCHILDREN);
+        GetBackend().Invalidate(GetHWND());
     }
 
     TaskQueue IWindow::Tasks = {};
 
     TextField::TextField(const WindowTransform& transform, const IWindow& window, std::string_view defaultText):
-        IWindow(IWindowType{ "Edit",  TEXT_FIELD_FLAGS }, defaultText, transform, &window),
+        IWindow(IWindowType{ "Edit", 0 }, defaultText, transform, &window),
         _text(defaultText)
     {
 
@@ -114,15 +137,13 @@ namespace Secretest
 
     void TextField::SetText(std::string_view text)
     {
-        SetWindowTextA(GetHWND(), text.data());
+        GetBackend().SetText(GetHWND(), text);
         _text = text;
     }
 
     void TextField::OnCommand()
     {
-        const int length = GetWindowTextLengthA(GetHWND());
-        _text = std::string(length, '\0');
-        GetWindowTextA(GetHWND(), _text.data(), length + 1);
+        _text = GetBackend().GetText(GetHWND());
     }
 
     Label::Label(std::string_view text, const WindowTransform& transform, const IWindow& window):
@@ -133,120 +154,86 @@ namespace Secretest
 
     void Label::SetText(std::string_view text) const
     {
-        SetWindowTextA(GetHWND(), text.data());
+        GetBackend().SetText(GetHWND(), text);
     }
 
 
-    WindowTransform IWindow::GetGlobalTransform() const
+    WindowTransform IWindow::Normalize() const
     {
         if(_parent)
-            return _transform.Normalize(_parent->GetGlobalTransform().Size);
+            return _transform.Normalize(_parent->_globalTransform.Size);
         return _transform.Normalize(vec2(1));
     }
 
     void IWindow::SetWindowTransform(const WindowTransform& transform)
     {
-        _transform = transform;
-
-        UpdateTransform();
-    }
+        if(transform == _transform)
+            return;
 
-    void IWindow::UpdateTransform() const
-    {
-        const WindowTransform globalTransform = GetGlobalTransform();
-        SetWindowPos(
-            _hwnd,
-            nullptr,
-            static_cast<int>(globalTransform.Position.x),
-            static_cast<int>(globalTransform.Position.y),
-            static_cast<int>(globalTransform.Size.x),
-            static_cast<int>(globalTransform.Size.y),
-            0
-        );
+        _transform = transform;
+        Layout(Normalize());
     }
 
-    void IWindow::OnPaint()
+    void IWindow::SetWindowTransformInternal(const WindowTransform& transform)
     {
-        UpdateTransform();
-
-        EnumChildWindows(GetHWND(), [](HWND hwnd, LPARAM)
-        {
-            IWindow* window = reinterpret_cast<IWindow*>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
-
-            window->OnPaint();
-
-            return 1;
-        },0);
+        _transform = transform;
 
-        RepaintAll();
-    }
+        const WindowTransform globalTransform = Normalize();
+        const bool isResized = globalTransform.Size != _globalTransform.Size;
+        _globalTransform = globalTransform;
 
-    Window::Window(std::string_view name, uvec2 pos, uvec2 size, WindowType type) :
-       IWindow(IWindowType{ type == WindowType::Normal ? "Window" : "Popup", static_cast<long>(type) }, name, WindowTransform{vec2(pos), vec2(size), TransformMode::Absolute, TransformMode::Absolute})
-    {
+        if(isResized)
+            LayoutChildren();
     }
 
-    void Window::OnPaint()
+    void IWindow::Layout(const WindowTransform& globalTransform)
     {
-        EnumChildWindows(GetHWND(), [](HWND hwnd, LPARAM)
-        {
-            IWindow* window = reinterpret_cast<IWindow*>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
-
-            window->OnPaint();
-
-            return 1;
-        },0);
-
-        RepaintAll();
+        if(globalTransform == _globalTransform)
+            return;
 
-        PAINTSTRUCT ps;
-        HDC hdc = BeginPaint(GetHWND(), &ps);
+        const bool isResized = globalTransform.Size != _globalTransform.Size;
+        _globalTransform = globalTransform;
 
-        FillRect(hdc, &ps.rcPaint, reinterpret_cast<HBRUSH>(COLOR_WINDOW));
+        GetBackend().SetRect(_hwnd, _globalTransform);
 
-        EndPaint(GetHWND(), &ps);
+        if(isResized)
+            LayoutChildren();
     }
 
-    void Window::RunWindows()
+    void IWindow::LayoutChildren()
     {
-        SetTimer(nullptr, 0, 100, nullptr);
-        MSG msg{};
-        while (GetMessageA(&msg, nullptr, 0, 0))
-        {
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
+        for(IWindow* child : _children)
+            child->Layout(child->Normalize());
 
-            Tasks.RunAllTasks();
-        }
+        OnLayout();
     }
 
-    LRESULT Window::WindowProc(HWND hwnd, UINT uMSG, WPARAM wParam, LPARAM lParam)
+    Window::Window(std::string_view name, uvec2 pos, uvec2 size, WindowType type) :
+       IWindow(IWindowType{ type == WindowType::Normal ? "Window" : "Popup", static_cast<long>(type) }, name, WindowTransform{vec2(pos), vec2(size), TransformMode::Absolute, TransformMode::Absolute}),
+       _type(type)
     {
-        Window* window = reinterpret_cast<Window*>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
-
-        if(window && window->IsOpen())
-            window->ProcessInput(uMSG, wParam, lParam);
-
-        return DefWindowProcA(hwnd, uMSG, wParam, lParam);
     }
 
-    LRESULT Window::WindowProcNoQuit(HWND hwnd, UINT uMSG, WPARAM wParam, LPARAM lParam)
+    // Children are native controls and paint themselves.
+    void Window::OnPaint()
     {
-        if(uMSG == WM_DESTROY)
-            return 1;
-
-        return WindowProc(hwnd, uMSG, wParam, lParam);
+        GetBackend().PaintBackground(GetHWND());
     }
 
-    void Window::RegisterDefaultStyles()
+    void Window::OnResize(uvec2 size)
     {
-        static bool wasRegistered = false;
-        if(wasRegistered) return;
-
-        RegisterStyle(IWindowClass{ "Window", WindowProc });
-        RegisterStyle(IWindowClass{ "Popup", WindowProcNoQuit });
+        SetWindowTransformInternal(WindowTransform{
+            GetRelativeTransform().Position,
+            vec2(size),
+            TransformMode::Absolute,
+            TransformMode::Absolute
+        });
+        RepaintAll();
+    }
 
-        wasRegistered = true;
+    void Window::RunWindows()
+    {
+        GetBackend().Run();
     }
 
     void Window::SetWindowTransform(uvec2 position, uvec2 size)
@@ -258,50 +245,4 @@ namespace Secretest
             TransformMode::Absolute
         });
     }
-
-    void Window::RegisterStyle(const IWindowClass& windowClass)
-    {
-        HINSTANCE hInstance = GetModuleHandle(nullptr);
-
-        WNDCLASS wndclass{};
-        wndclass.lpszClassName = windowClass.Name.data();
-        wndclass.hInstance = hInstance;
-        wndclass.lpfnWndProc = windowClass.WindowProc;
-
-        RegisterClass(&wndclass);
-    }
-
-    void Window::ProcessInput(uint message, uint64_t wParam, int64_t param)
-    {
-        IWindow* window = reinterpret_cast<IWindow*>(GetWindowLongPtr(reinterpret_cast<HWND>(param), GWLP_USERDATA));
-        LPMINMAXINFO minMaxInfo = reinterpret_cast<LPMINMAXINFO>(param);
-
-        switch(message)
-        {
-        case WM_DESTROY:
-            PostQuitMessage(0);
-            break;
-        case WM_SIZE:
-            SetWindowTransformInternal(WindowTransform{
-                GetRelativeTransform().Position,
-                vec2(LOWORD(param), HIWORD(param)),
-                TransformMode::Absolute,
-                TransformMode::Absolute
-            });
-            RepaintAll();
-            break;
-        case WM_PAINT:
-            OnPaint();
-            break;
-        case WM_COMMAND:
-            window->OnCommand();
-            break;
-        case WM_GETMINMAXINFO:
-            minMaxInfo->ptMinTrackSize = POINT(_minSize.x, _minSize.y);
-            minMaxInfo->ptMaxTrackSize = POINT(_maxSize.x, _maxSize.y);
-            break;
-        default:
-            break;
-        }
-    }
 }
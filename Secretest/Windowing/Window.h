@@ -8,16 +8,16 @@
 
 #include <Secretest/Utility/vec2.h>
 #include <functional>
-#include <minwindef.h>
 #include <string>
 #include <thread>
+#include <vector>
 
 using HWND = class HWND__*;
-using ATOM = uint16_t;
-using LRESULT = int64_t;
 
 namespace Secretest
 {
+    class IWindowBackend;
+
     enum class TransformMode : uint8_t
     {
         Relative,
@@ -33,6 +33,8 @@ namespace Secretest
         vec<2, TransformMode> ScaleMode = TransformMode::Relative;
 
         [[nodiscard]] WindowTransform Normalize(vec2 windowSize) const;
+
+        bool operator==(const WindowTransform&) const = default;
     };
 
     struct IWindowType
@@ -41,13 +43,6 @@ namespace Secretest
         long Flags;
     };
 
-    using WindowProc = LRESULT(*)(HWND, uint, uint64_t, int64_t);
-    struct IWindowClass
-    {
-        std::string_view Name;
-        WindowProc WindowProc;
-    };
-
     class IWindow
     {
     public:
@@ -61,17 +56,30 @@ namespace Secretest
         IWindow& operator=(const IWindow&) = delete;
 
         [[nodiscard]] const WindowTransform& GetRelativeTransform() const { return _transform; }
-        [[nodiscard]] WindowTransform GetGlobalTransform() const;
+        // Cached, kept up to date by the layout pass.
+        [[nodiscard]] const WindowTransform& GetGlobalTransform() const { return _globalTransform; }
+        // Lays out this window and whichever descendants depend on its size, if anything changed.
         void SetWindowTransform(const WindowTransform& transform);
 
+        [[nodiscard]] const IWindow* GetParent() const { return _parent; }
+        [[nodiscard]] const std::vector<IWindow*>& GetChildren() const { return _children; }
+
         void RepaintAll() const;
 
+        // Must be set before the first window is created. Defaults to Win32 on Windows, headless elsewhere.
+        static void SetBackend(IWindowBackend& backend) { _backend = &backend; }
+        static IWindowBackend& GetBackend();
+
         friend class Window;
+        friend class IWindowBackend;
 
     protected:
         virtual void OnCommand() = 0;
-        virtual void OnPaint();
-        void SetWindowTransformInternal(const WindowTransform& transform) { _transform = transform; }
+        virtual void OnPaint() {};
+        // The global transform changed size.
+        virtual void OnLayout() {};
+        // For when the platform already moved the native window.
+        void SetWindowTransformInternal(const WindowTransform& transform);
         [[nodiscard]] bool IsOpen() const { return _isOpen; }
 
         static TaskQueue Tasks;
@@ -79,13 +87,26 @@ namespace Secretest
         [[nodiscard]] HWND GetHWND() const { return _hwnd; }
 
     private:
-        void UpdateTransform() const;
+        void Release();
+        void TakeOver(IWindow& b);
+
+        [[nodiscard]] WindowTransform Normalize() const;
+        // Children only depend on their parent's size, so a move stops here.
+        void Layout(const WindowTransform& globalTransform);
+        void LayoutChildren();
+
+        static IWindowBackend* _backend;
 
         HWND _hwnd;
         bool _isOpen = true;
 
         const IWindow* _parent;
+        // Children register themselves with their parent, which is otherwise const to them.
+        mutable std::vector<IWindow*> _children;
+
         WindowTransform _transform;
+        // Also what the native window was last positioned at.
+        WindowTransform _globalTransform;
     };
 
     template<class FUNC_T>
@@ -164,8 +185,6 @@ namespace Secretest
         Window(std::string_view name, uvec2 pos, uvec2 size, WindowType type = WindowType::Normal);
 
         static void RunWindows();
-        static void RegisterStyle(const IWindowClass& windowClass);
-        static void RegisterDefaultStyles();
 
         void SetWindowTransform(uvec2 position, uvec2 size);
 
@@ -173,18 +192,24 @@ namespace Secretest
         void SetMinSize(uvec2 min) { _minSize = min; }
         void SetMaxSize(uvec2 max) { _maxSize = max; }
 
+        [[nodiscard]] uvec2 GetMinSize() const { return _minSize; }
+        [[nodiscard]] uvec2 GetMaxSize() const { return _maxSize; }
+        [[nodiscard]] WindowType GetType() const { return _type; }
+
+        friend class IWindowBackend;
+
     protected:
-        virtual void ProcessInput(uint message, uint64_t wParam, int64_t param);
+        virtual void OnResize(uvec2 size);
+        // In notches, positive is away from the user.
+        virtual void OnScroll(int32_t delta) {};
         void OnPaint() override;
         void OnCommand() override {};
 
     private:
-        static LRESULT WindowProc(HWND, uint, uint64_t, int64_t);
-        static LRESULT WindowProcNoQuit(HWND hwnd, UINT uMSG, WPARAM wParam, LPARAM lParam);
-
         using IWindow::SetWindowTransform;
 
+        WindowType _type;
         uvec2 _minSize = 0;
         uvec2 _maxSize = INT32_MAX;
     };
-}
\ No newline at end of file
+}
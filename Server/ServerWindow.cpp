@@ -4,6 +4,8 @@
 
 #include "ServerWindow.h"
 
+#include <Secretest/Networking/SharedMemory.h>
+
 #include <sstream>
 
 using namespace std::string_view_literals;
@@ -18,6 +20,9 @@ namespace Secretest
         _submitMessageButton("Send", WindowTransform{ vec2(0.3f, 0.15f), vec2(0.3f, 0.05f) }, *this, this, &ServerWindow::SubmitMessageButton)
     {
         SetMinSize(512);
+
+        // Bots and bridges on this machine connect with SharedMemoryTransport::Connect and the port as the name.
+        AddListener(std::make_unique<SharedMemoryListener>(std::to_string(port)));
         Listen();
     }
 